@@ -1,4 +1,5 @@
 #include "communications.h"
+#include "lighting.h"
 #include <Adafruit_NeoPixel.h>
 
 // BLE globals
@@ -10,8 +11,6 @@ bool deviceConnected = false;
 #define CHARACTERISTIC_UUID "beb5483e-36e1-4688-b7f5-ea07361b2623"
 #define ESPNAME "Music Strip"
 
-constexpr int MIN_LED_COUNT = 1;
-constexpr int MAX_LED_COUNT = 1000;
 constexpr uint16_t DEFAULT_COLOR_ORDER = NEO_GRB + NEO_KHZ800;
 
 // Convert 0-100 scale to 0-255 PWM scale
@@ -21,11 +20,72 @@ uint8_t convertBrightness(int valu) {
   return (uint8_t)(valu * 2.55);  // Linear scale: 1=2.55, 50=127.5, 100=255
 }
 
+// Guards the updated/changes handoff between the BLE and ESP-NOW tasks and handleStrip
+static portMUX_TYPE settingsMux = portMUX_INITIALIZER_UNLOCKED;
+
+// Publish an update's changes on top of any handleStrip has not taken yet
+static void markUpdated(struct_message& data, uint8_t changes) {
+  portENTER_CRITICAL(&settingsMux);
+  data.changes = (data.updated ? data.changes : 0) | changes;
+  data.updated = true;
+  portEXIT_CRITICAL(&settingsMux);
+}
+
+bool takeSettingsUpdate(struct_message& data, uint8_t& changes) {
+  portENTER_CRITICAL(&settingsMux);
+  bool updated = data.updated;
+  changes = data.changes;
+  data.updated = false;
+  data.changes = 0;
+  portEXIT_CRITICAL(&settingsMux);
+  return updated;
+}
+
 // Clone struct data
 void cloneData(const struct_message& source, struct_message& destination) {
   memcpy(&destination, &source, sizeof(struct_message));
 }
 
+uint8_t settingsChanges(const struct_message& before, const struct_message& after) {
+  uint8_t changes = 0;
+  if (before.brightness != after.brightness) changes |= CHANGE_BRIGHTNESS;
+  if (before.colorOne != after.colorOne || before.colorTwo != after.colorTwo || before.colorThree != after.colorThree) {
+    changes |= CHANGE_COLORS;
+  }
+  if (before.speed != after.speed || before.intensity != after.intensity || before.direction != after.direction ||
+      before.count != after.count) {
+    changes |= CHANGE_PARAMS;
+  }
+
+  if (before.modeId != after.modeId || before.layerCount != after.layerCount || before.segmentCount != after.segmentCount ||
+      memcmp(before.layers, after.layers, after.layerCount * sizeof(LayerConfig)) != 0) {
+    changes |= CHANGE_MODE;
+  }
+  for (int i = 0; i < after.segmentCount; i++) {
+    const SegmentConfig& a = before.segments[i];
+    const SegmentConfig& b = after.segments[i];
+    if (a.modeId != b.modeId || a.start != b.start || a.length != b.length) changes |= CHANGE_MODE;
+    if (a.colorOne != b.colorOne || a.colorTwo != b.colorTwo || a.colorThree != b.colorThree) changes |= CHANGE_COLORS;
+    if (a.speed != b.speed || a.intensity != b.intensity || a.direction != b.direction || a.count != b.count ||
+        a.frameMs != b.frameMs) {
+      changes |= CHANGE_PARAMS;
+    }
+  }
+
+  if (before.ledCount != after.ledCount || before.pixelPin != after.pixelPin || before.pixelCount != after.pixelCount ||
+      before.colorOrder != after.colorOrder || before.outputCount != after.outputCount ||
+      memcmp(before.outputs, after.outputs, after.outputCount * sizeof(OutputConfig)) != 0) {
+    changes |= CHANGE_GEOMETRY;
+  }
+  if (before.gamma != after.gamma || before.colorCorrection != after.colorCorrection || before.dither != after.dither ||
+      before.maxCurrent != after.maxCurrent || before.ledMilliamps != after.ledMilliamps ||
+      before.idleMilliamps != after.idleMilliamps || before.keepAlive != after.keepAlive ||
+      before.linearBlend != after.linearBlend) {
+    changes |= CHANGE_OUTPUT;
+  }
+  return changes;
+}
+
 bool checkMemory() {
   size_t freeHeap = ESP.getFreeHeap();
   if (freeHeap < 15000) {
@@ -43,7 +103,11 @@ void formatMacAddress(const uint8_t *macAddr, char *buffer, int maxLength) {
 
 void gotBroadcast(const uint8_t *mac, const uint8_t *incomingData, int len) {
   Serial.print(F("gotBroadcast: "));
-  memcpy(&myData, incomingData, sizeof(myData));
+  extern struct_message myOldData;
+  if (!myData.updated) cloneData(myData, myOldData);
+  // The sender's own handoff flags are left out; markUpdated merges this update into any pending one
+  memcpy(&myData, incomingData, min((size_t)len, offsetof(struct_message, updated)));
+  markUpdated(myData, settingsChanges(myOldData, myData));
   Serial.print(F("Data received: "));
   Serial.println(len); 
 
@@ -98,11 +162,24 @@ class BleConnectionCallbacks : public BLEServerCallbacks {
 
 void debugParsedData(const struct_message &data) {
   Serial.println(F("=== Parsed JSON Data ==="));
-  Serial.printf("brightness: %d | lightMode: %s\n", data.brightness, data.lightMode);
+  Serial.printf("brightness: %d | lightMode: %s (id %d)\n", data.brightness, data.lightMode, data.modeId);
+  for (int i = 0; i < data.layerCount; i++) {
+    Serial.printf("layer %d: %s | blend: %d | opacity: %d\n", i, modeTable[data.layers[i].modeId].name, data.layers[i].blend, data.layers[i].opacity);
+  }
+  for (int i = 0; i < data.segmentCount; i++) {
+    const SegmentConfig& segment = data.segments[i];
+    Serial.printf("segment %d: %d+%d | %s | speed: %d | frameMs: %d\n", i, segment.start, segment.length, modeTable[segment.modeId].name, segment.speed, segment.frameMs);
+  }
   Serial.printf("colors: one=0x%06X, two=0x%06X, three=0x%06X\n", data.colorOne, data.colorTwo, data.colorThree);
   Serial.printf("speed: %d | intensity: %d | direction: %d | count: %d\n", data.speed, data.intensity, data.direction, data.count);
-  Serial.printf("hardware: maxCurrent=%d | colorOrder: 0x%04X\n", data.maxCurrent, data.colorOrder);
+  Serial.printf("power: ledMilliamps=%d | idleMilliamps=%d\n", data.ledMilliamps, data.idleMilliamps);
+  Serial.printf("hardware: maxCurrent=%d | colorOrder: 0x%04X | keepAlive: %dms\n", data.maxCurrent, data.colorOrder, data.keepAlive);
+  Serial.printf("output: gamma=%d.%d | colorCorrection=0x%06X | dither: %d\n", data.gamma / 10, data.gamma % 10, data.colorCorrection, data.dither);
+  Serial.printf("seed: 0x%08X | slewMs: %d | changes: 0x%02X\n", data.seed, data.slewMs, data.changes);
   Serial.printf("pins: pixelPin=%d | ledCount=%d | pixelCount=%d\n", data.pixelPin, data.ledCount, data.pixelCount);
+  for (int i = 0; i < data.outputCount; i++) {
+    Serial.printf("output %d: pin=%d | length=%d | colorOrder: 0x%04X\n", i, data.outputs[i].pixelPin, data.outputs[i].pixelCount, data.outputs[i].colorOrder);
+  }
   checkMemory();
   Serial.println(F("========================"));
 }
@@ -165,6 +242,133 @@ uint32_t parseColorValue(JsonVariantConst value, uint32_t fallback) {
   return fallback;
 }
 
+// Fields that configure a mode: used for the top-level settings and for each segment
+void applyModeSettings(JsonVariantConst json, struct_message &data) {
+  if (json.containsKey("lightMode")) {
+    const char* mode = json["lightMode"];
+    int modeId = findModeId(mode);
+    if (modeId != MODE_UNKNOWN) {
+      strlcpy(data.lightMode, mode, sizeof(data.lightMode));
+      data.modeId = modeId;
+    } else {
+      Serial.printf("Unknown lightMode: %s\n", mode ? mode : "(null)");
+    }
+  }
+  if (json.containsKey("colorOne")) {
+    data.colorOne = parseColorValue(json["colorOne"], data.colorOne);
+  }
+  if (json.containsKey("colorTwo")) {
+    data.colorTwo = parseColorValue(json["colorTwo"], data.colorTwo);
+  }
+  if (json.containsKey("colorThree")) {
+    data.colorThree = parseColorValue(json["colorThree"], data.colorThree);
+  }
+  if (json.containsKey("speed")) {
+    int speed = json["speed"];
+    data.speed = constrain(speed, 0, 100);
+  }
+  if (json.containsKey("intensity")) {
+    int intensity = json["intensity"];
+    data.intensity = constrain(intensity, 0, 100);
+  }
+  if (json.containsKey("count")) {
+    int count = json["count"];
+    data.count = constrain(count, 0, 100);
+  }
+  if (json.containsKey("direction")) {
+    int direction = json["direction"];
+    data.direction = constrain(direction, 0, 2);
+  }
+}
+
+// "layers": [{"mode": "twinkles", "blend": "add", "opacity": 255}, ...], bottom to top over the
+// base lightMode. An empty array goes back to a single mode.
+void parseLayers(JsonArrayConst layers, struct_message &data) {
+  int count = 0;
+  for (JsonVariantConst entry : layers) {
+    if (count == MAX_LAYERS) {
+      Serial.printf("Ignoring layers beyond %d\n", MAX_LAYERS);
+      break;
+    }
+    const char* mode = entry["mode"];
+    int modeId = findModeId(mode);
+    if (modeId == MODE_UNKNOWN) {
+      Serial.printf("Unknown layer mode: %s\n", mode ? mode : "(null)");
+      continue;
+    }
+    const char* blend = entry["blend"] | "add";
+    LayerConfig& layer = data.layers[count++];
+    layer.modeId = modeId;
+    layer.blend = strcmp(blend, "max") == 0      ? BLEND_MAX
+                : strcmp(blend, "alpha") == 0    ? BLEND_ALPHA
+                : strcmp(blend, "multiply") == 0 ? BLEND_MULTIPLY
+                                                 : BLEND_ADD;
+    layer.opacity = entry.containsKey("opacity") ? constrain((int)entry["opacity"], 0, 255) : 255;
+  }
+  data.layerCount = count;
+}
+
+// "segments": [{"start": 0, "length": 120, "lightMode": "aurora", "speed": 30, "frameMs": 20}, ...].
+// Each segment takes the mode fields of the top-level settings and overrides what it names. start
+// defaults to the end of the previous segment. An empty array goes back to one mode for the strip.
+void parseSegments(JsonArrayConst segments, struct_message &data) {
+  int count = 0;
+  int nextStart = 0;
+  for (JsonVariantConst entry : segments) {
+    if (count == MAX_SEGMENTS) {
+      Serial.printf("Ignoring segments beyond %d\n", MAX_SEGMENTS);
+      break;
+    }
+    int start = entry.containsKey("start") ? constrain((int)entry["start"], 0, data.ledCount - 1) : nextStart;
+    if (start >= data.ledCount) break;
+    int length = constrain((int)entry["length"], 1, data.ledCount - start);
+
+    struct_message settings;
+    cloneData(data, settings);
+    applyModeSettings(entry, settings);
+
+    SegmentConfig& segment = data.segments[count++];
+    segment.start = start;
+    segment.length = length;
+    segment.modeId = settings.modeId;
+    segment.speed = settings.speed;
+    segment.intensity = settings.intensity;
+    segment.direction = settings.direction;
+    segment.count = settings.count;
+    segment.frameMs = constrain((int)(entry["frameMs"] | 0), 0, 255);
+    segment.colorOne = settings.colorOne;
+    segment.colorTwo = settings.colorTwo;
+    segment.colorThree = settings.colorThree;
+    nextStart = start + length;
+  }
+  data.segmentCount = count;
+}
+
+// "outputs": [{"pin": 15, "length": 250, "colorOrder": "GRB"}, ...]. Chains take consecutive
+// ranges of the strip; an empty array goes back to the single pixelPin strip.
+void parseOutputs(JsonArrayConst outputs, struct_message &data) {
+  int count = 0;
+  int total = 0;
+  for (JsonVariantConst entry : outputs) {
+    if (count == MAX_OUTPUTS) {
+      Serial.printf("Ignoring outputs beyond %d\n", MAX_OUTPUTS);
+      break;
+    }
+    int length = constrain((int)entry["length"], MIN_LED_COUNT, MAX_LED_COUNT - total);
+    if (length <= 0) break;
+    OutputConfig& out = data.outputs[count++];
+    out.pixelPin = constrain((int)entry["pin"], 0, 48);
+    out.pixelCount = length;
+    out.colorOrder = entry.containsKey("colorOrder") ? parseColorOrder(entry["colorOrder"]) : data.colorOrder;
+    total += length;
+  }
+  data.outputCount = count;
+  if (count > 0) {
+    data.ledCount = total;
+    data.pixelCount = total;
+  }
+}
+
 void parseAndUpdateData(const std::string &jsonString, struct_message &data) {
   if (!checkMemory()) {
     Serial.println(F("Cannot parse data - insufficient memory"));
@@ -183,24 +387,17 @@ void parseAndUpdateData(const std::string &jsonString, struct_message &data) {
     return;
   } 
 
+  // myOldData keeps what is on the strip until handleStrip has consumed the pending update
   extern struct_message myOldData;
-  memcpy(&myOldData, &data, sizeof(struct_message));
+  if (!data.updated) cloneData(data, myOldData);
 
   if (jsonDoc.containsKey("brightness")) {
     int brightness = jsonDoc["brightness"];
     data.brightness = constrain(brightness, 0, 100);
   }
-  if (jsonDoc.containsKey("lightMode")) {
-    strlcpy(data.lightMode, (const char*)jsonDoc["lightMode"], sizeof(data.lightMode));
-  }
-  if (jsonDoc.containsKey("colorOne")) {
-    data.colorOne = parseColorValue(jsonDoc["colorOne"], data.colorOne);
-  }
-  if (jsonDoc.containsKey("colorTwo")) {
-    data.colorTwo = parseColorValue(jsonDoc["colorTwo"], data.colorTwo);
-  }
-  if (jsonDoc.containsKey("colorThree")) {
-    data.colorThree = parseColorValue(jsonDoc["colorThree"], data.colorThree);
+  applyModeSettings(jsonDoc.as<JsonVariantConst>(), data);
+  if (jsonDoc.containsKey("layers")) {
+    parseLayers(jsonDoc["layers"].as<JsonArrayConst>(), data);
   }
   bool ledCountUpdated = false;
   if (jsonDoc.containsKey("ledCount")) {
@@ -214,6 +411,12 @@ void parseAndUpdateData(const std::string &jsonString, struct_message &data) {
   if (jsonDoc.containsKey("maxCurrent")) {
     data.maxCurrent = constrain((int)jsonDoc["maxCurrent"], 0, 50000);
   }
+  if (jsonDoc.containsKey("ledMilliamps")) {
+    data.ledMilliamps = constrain((int)jsonDoc["ledMilliamps"], 1, 100);
+  }
+  if (jsonDoc.containsKey("idleMilliamps")) {
+    data.idleMilliamps = constrain((int)jsonDoc["idleMilliamps"], 0, 10);
+  }
   if (jsonDoc.containsKey("pixelPin")) {
     data.pixelPin = constrain((int)jsonDoc["pixelPin"], 0, 48);
   }
@@ -222,23 +425,37 @@ void parseAndUpdateData(const std::string &jsonString, struct_message &data) {
   } else if (ledCountUpdated) {
     data.pixelCount = data.ledCount;
   }
-  if (jsonDoc.containsKey("speed")) {
-    int speed = jsonDoc["speed"];
-    data.speed = constrain(speed, 0, 100);
+  if (jsonDoc.containsKey("outputs")) {
+    parseOutputs(jsonDoc["outputs"].as<JsonArrayConst>(), data);
   }
-  if (jsonDoc.containsKey("intensity")) {
-    int intensity = jsonDoc["intensity"];
-    data.intensity = constrain(intensity, 0, 100);
+  // After everything else, so segments inherit the final top-level mode fields and ledCount
+  if (jsonDoc.containsKey("segments")) {
+    parseSegments(jsonDoc["segments"].as<JsonArrayConst>(), data);
   }
-  if (jsonDoc.containsKey("count")) {
-    int count = jsonDoc["count"];
-    data.count = constrain(count, 0, 100);
-  } 
-  if (jsonDoc.containsKey("direction")) {
-    int direction = jsonDoc["direction"];
-    data.direction = constrain(direction, 0, 2);
-  } 
-  data.updated = true;
+  if (jsonDoc.containsKey("linearBlend")) {
+    data.linearBlend = jsonDoc["linearBlend"];
+  }
+  if (jsonDoc.containsKey("gamma")) {
+    float gamma = jsonDoc["gamma"];
+    data.gamma = constrain((int)(gamma * 10.0f + 0.5f), 10, 30);
+  }
+  if (jsonDoc.containsKey("colorCorrection")) {
+    data.colorCorrection = parseColorValue(jsonDoc["colorCorrection"], data.colorCorrection);
+  }
+  if (jsonDoc.containsKey("dither")) {
+    data.dither = jsonDoc["dither"];
+  }
+  if (jsonDoc.containsKey("keepAlive")) {
+    int keepAlive = jsonDoc["keepAlive"];
+    data.keepAlive = constrain(keepAlive, 0, 60000);
+  }
+  if (jsonDoc.containsKey("seed")) {
+    data.seed = jsonDoc["seed"];
+  }
+  if (jsonDoc.containsKey("slewMs")) {
+    data.slewMs = constrain((int)jsonDoc["slewMs"], 0, 5000);
+  }
+  markUpdated(data, settingsChanges(myOldData, data));
   debugParsedData(data); 
 }
 
@@ -10,25 +10,98 @@
 #include <BLEServer.h>
 #include <string>
 
+constexpr int MIN_LED_COUNT = 1;
+constexpr int MAX_LED_COUNT = 1000;
+constexpr int MAX_OUTPUTS = 4; // Physical LED chains, one RMT channel each
+
+constexpr int MAX_LAYERS = 3; // Modes stacked on top of the base mode
+
+// How a layer is combined with everything beneath it
+enum LayerBlend : uint8_t {
+  BLEND_ADD,      // Per-channel saturating add
+  BLEND_MAX,      // Per-channel maximum
+  BLEND_ALPHA,    // Lit pixels cover the layers below at the layer's opacity; black is transparent
+  BLEND_MULTIPLY, // Per-channel multiply, for masks and dimmers
+};
+
+struct LayerConfig {
+  int modeId;
+  uint8_t blend;   // LayerBlend
+  uint8_t opacity; // 0-255, scales the layer before blending
+};
+
+constexpr int MAX_SEGMENTS = 4; // Independent pixel ranges, each running its own mode
+
+// A contiguous range of the strip with its own mode and mode parameters
+struct SegmentConfig {
+  uint16_t start;
+  uint16_t length;
+  int8_t modeId;
+  uint8_t speed;
+  uint8_t intensity;
+  uint8_t direction;
+  uint8_t count;
+  uint8_t frameMs; // Render period; 0 = the mode's own rate
+  uint32_t colorOne;
+  uint32_t colorTwo;
+  uint32_t colorThree;
+};
+
+// One physical LED chain. Chains take consecutive ranges of the logical strip in order.
+struct OutputConfig {
+  int pixelPin;
+  int pixelCount;
+  uint16_t colorOrder;
+};
+
 // Define the message structure
 typedef struct struct_message {
   int brightness;
   char lightMode[32];
+  int modeId;       // Index into modeTable, resolved from lightMode when it is received
   uint32_t colorOne;
   uint32_t colorTwo;
   uint32_t colorThree;
   int ledCount;
-  int maxCurrent;
+  int maxCurrent;   // Strip current budget in mA (0 = unlimited)
+  int ledMilliamps; // Draw of one LED channel at full output, mA
+  int idleMilliamps; // Quiescent draw of one LED, mA
   uint16_t colorOrder;
   int pixelPin;
   int pixelCount;
+  int outputCount;  // Chains in outputs[]; 0 = a single strip on pixelPin
+  OutputConfig outputs[MAX_OUTPUTS];
   int speed;        // Animation speed (0-100)
   int intensity;    // Effect intensity (0-100)
   int direction;    // Direction: 0=forward, 1=reverse, 2=bounce
   int count;        // Count parameter for effects
+  int layerCount;   // Modes in layers[] composited over the base mode (0 = base mode only)
+  LayerConfig layers[MAX_LAYERS];
+  int segmentCount; // Ranges in segments[], each with its own mode (0 = one mode for the whole strip)
+  SegmentConfig segments[MAX_SEGMENTS];
+  bool linearBlend; // Crossfade transitions in linear light instead of gamma space
+  int keepAlive;    // Refresh an unchanged strip every keepAlive ms (0 = only send changes)
+  int gamma;        // Output gamma x10 (10 = none, 22 = typical for WS2812)
+  uint32_t colorCorrection; // Per-channel white balance as 0xRRGGBB scale (0xFFFFFF = none)
+  bool dither;      // Temporal dithering of the output for smoother low-brightness fades
+  uint32_t seed;    // Random stream seed for the modes; same seed + clock = same frames (0 = random per scene)
+  int slewMs;       // Glide time for speed, intensity and color changes, ms (0 = jump)
   bool updated;
+  uint8_t changes;  // SettingsChange bits of the updates since handleStrip last consumed one
 } struct_message;
 
+// What a settings update touched, so each stage only reacts to its own part. Dragging the
+// brightness slider must not blank the strip or restart the modes.
+enum SettingsChange : uint8_t {
+  CHANGE_BRIGHTNESS = 1 << 0, // brightness: output LUT only
+  CHANGE_COLORS     = 1 << 1, // colorOne/Two/Three, also of segments
+  CHANGE_PARAMS     = 1 << 2, // speed, intensity, direction, count, also of segments
+  CHANGE_MODE       = 1 << 3, // The mode stack: lightMode, layers, segment modes and ranges
+  CHANGE_GEOMETRY   = 1 << 4, // ledCount, pins, color orders and chains
+  CHANGE_OUTPUT     = 1 << 5, // gamma, color correction, dither, power limit, keep-alive, blending
+  CHANGE_ALL        = 0xFF,
+};
+
 // Forward declarations
 class Adafruit_NeoPixel;
 
@@ -45,6 +118,12 @@ extern uint8_t convertBrightness(int valu);
 
 // Data management functions
 void cloneData(const struct_message& source, struct_message& destination);
+// SettingsChange bits for the fields that differ between before and after. The seed and slew time
+// are left out: they only shape later changes.
+uint8_t settingsChanges(const struct_message& before, const struct_message& after);
+// Take the pending update, if any, and its SettingsChange bits in one step, so an update that
+// arrives while a frame renders is kept for the next one instead of being cleared with it
+bool takeSettingsUpdate(struct_message& data, uint8_t& changes);
 
 // BLE functions
 void initializeBLE();
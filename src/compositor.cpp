@@ -0,0 +1,438 @@
+#include "compositor.h"
+#include <Arduino.h>
+#include <assert.h>
+
+static StripData* baseFrame = nullptr;
+static StripData* layerFrames[MAX_LAYERS];
+
+// Segment views point into the output frame; their settings are expanded once per update
+static StripData* segmentViews[MAX_SEGMENTS];
+static struct_message segmentSettings[MAX_SEGMENTS];
+static uint32_t segmentNextMs[MAX_SEGMENTS];
+
+// A segment scene has no layers, so segments running a MODE_ENVELOPE mode keep their unscaled
+// pixels in the idle base and layer frames and copy them into the output scaled by their envelope
+static_assert(MAX_SEGMENTS <= MAX_LAYERS + 1, "every segment needs a source frame");
+static StripData* segmentSources[MAX_SEGMENTS];
+static int segmentEnvelopes[MAX_SEGMENTS]; // Envelope last written to the output; -1 = not written yet
+
+// Outgoing scene handling. A decimated old mode renders into oldKeys[1] every transitionStride
+// frames, after saving its previous output to oldKeys[0]; the frames between are interpolated.
+static StripData* oldKeys[2];
+static TransitionPolicy transitionPolicy = TRANSITION_SNAPSHOT;
+static int transitionStride = 1;
+static int transitionStep = 0;
+
+// Share of the frame period the old and new scenes may fill together during a transition
+constexpr uint32_t TRANSITION_BUDGET_PERCENT = 75;
+// Beyond this stride the interpolated motion is too coarse to be worth rendering at all
+constexpr int MAX_TRANSITION_STRIDE = 8;
+
+// Mode instances of the running scene and of the one transitioning out
+struct SceneInstances {
+  ModeInstance* base;
+  ModeInstance* layers[MAX_LAYERS];
+  ModeInstance* segments[MAX_SEGMENTS];
+};
+static SceneInstances scenes[2];
+static SceneInstances* currentScene = &scenes[0];
+static SceneInstances* outgoingScene = &scenes[1];
+
+// Every mode in a scene draws from its own random stream, derived from the scene seed and its
+// position so the same mode in two places does not repeat itself
+static uint32_t instanceSeed(uint32_t sceneSeed, int slot) {
+  return (sceneSeed ^ (slot * 0x9E3779B9u)) * 0x85EBCA6Bu;
+}
+
+static void acquireScene(SceneInstances* scene, const struct_message& cfg) {
+  *scene = {};
+  uint32_t seed = cfg.seed ? cfg.seed : esp_random();
+  if (cfg.segmentCount > 0) {
+    for (int i = 0; i < cfg.segmentCount; i++) {
+      scene->segments[i] = acquireModeInstance(cfg.segments[i].modeId, instanceSeed(seed, 1 + MAX_LAYERS + i));
+    }
+    return;
+  }
+  scene->base = acquireModeInstance(cfg.modeId, instanceSeed(seed, 0));
+  for (int i = 0; i < cfg.layerCount; i++) {
+    scene->layers[i] = acquireModeInstance(cfg.layers[i].modeId, instanceSeed(seed, 1 + i));
+  }
+}
+
+static void releaseScene(SceneInstances* scene) {
+  releaseModeInstance(scene->base);
+  for (int i = 0; i < MAX_LAYERS; i++) releaseModeInstance(scene->layers[i]);
+  for (int i = 0; i < MAX_SEGMENTS; i++) releaseModeInstance(scene->segments[i]);
+  *scene = {};
+}
+
+void initCompositor(const struct_message& cfg) {
+  baseFrame = acquireFrame(0);
+  assert(baseFrame);
+  for (int i = 0; i < MAX_LAYERS; i++) {
+    layerFrames[i] = acquireFrame(0);
+    assert(layerFrames[i]);
+  }
+  for (int i = 0; i < MAX_SEGMENTS; i++) {
+    segmentViews[i] = new StripData(nullptr, 0);
+    segmentSources[i] = i == 0 ? baseFrame : layerFrames[i - 1];
+  }
+  oldKeys[0] = acquireFrame(0);
+  oldKeys[1] = acquireFrame(0);
+  assert(oldKeys[0] && oldKeys[1]);
+  acquireScene(currentScene, cfg);
+}
+
+// Clip a segment to the frame; returns its length (0 when it lies outside)
+static int segmentLength(const SegmentConfig& segment, const StripData* out) {
+  return constrain(out->pixelCount - segment.start, 0, (int)segment.length);
+}
+
+static uint16_t segmentFrameMs(const SegmentConfig& segment) {
+  return segment.frameMs ? segment.frameMs : modeTable[segment.modeId].frameMs;
+}
+
+// Mode parameters that differ between two settings. Scenes and segments name them alike.
+template <typename Settings>
+static uint8_t changedParams(const Settings& a, const Settings& b) {
+  uint8_t changed = 0;
+  if (a.speed != b.speed) changed |= PARAM_SPEED;
+  if (a.intensity != b.intensity) changed |= PARAM_INTENSITY;
+  if (a.direction != b.direction) changed |= PARAM_DIRECTION;
+  if (a.count != b.count) changed |= PARAM_COUNT;
+  if (a.colorOne != b.colorOne) changed |= PARAM_COLOR_ONE;
+  if (a.colorTwo != b.colorTwo) changed |= PARAM_COLOR_TWO;
+  if (a.colorThree != b.colorThree) changed |= PARAM_COLOR_THREE;
+  return changed;
+}
+
+// Settings the running scene last rendered with, so static modes can tell which of their
+// parameters moved since
+static struct_message renderedSettings;
+
+// Static modes only repaint on a restart or when a parameter they read moved; everything else
+// advances every frame
+static void renderMode(int modeId, StripData* frame, const struct_message& cfg, ModeInstance* instance, uint8_t moved, int64_t nowUs) {
+  if ((modeTable[modeId].flags & MODE_STATIC) && !cfg.updated && !(moved & modeTable[modeId].params)) return;
+  callModeFunction(modeId, frame, &cfg, instance, nowUs);
+}
+
+static void fitFrame(StripData* frame, int pixelCount) {
+  if (frame->pixelCount != pixelCount) {
+    frame->resize(pixelCount);
+    frame->clear();
+  }
+}
+
+static void resetSegments(StripData* out, const StripData* previous, const struct_message& cfg, bool newScene, int64_t nowUs) {
+  for (int i = 0; i < cfg.segmentCount; i++) {
+    const SegmentConfig& segment = cfg.segments[i];
+    struct_message& settings = segmentSettings[i];
+    cloneData(cfg, settings);
+    strlcpy(settings.lightMode, modeTable[segment.modeId].name, sizeof(settings.lightMode));
+    settings.modeId = segment.modeId;
+    settings.speed = segment.speed;
+    settings.intensity = segment.intensity;
+    settings.direction = segment.direction;
+    settings.count = segment.count;
+    settings.colorOne = segment.colorOne;
+    settings.colorTwo = segment.colorTwo;
+    settings.colorThree = segment.colorThree;
+    settings.layerCount = 0;
+    settings.segmentCount = 0;
+    segmentNextMs[i] = (uint32_t)(nowUs / 1000);
+
+    int length = segmentLength(segment, out);
+    StripData* target = out;
+    int offset = segment.start;
+    if (modeTable[segment.modeId].flags & MODE_ENVELOPE) {
+      // Restarting in place keeps the unscaled source; the output only ever holds it scaled
+      StripData* source = segmentSources[i];
+      segmentEnvelopes[i] = -1;
+      if (!newScene && source->pixelCount == length) continue;
+      source->resize(length);
+      source->clear();
+      target = source;
+      offset = 0;
+    }
+
+    if ((modeTable[segment.modeId].flags & MODE_INHERITS) && previous) {
+      int end = min(segment.start + length, previous->pixelCount);
+      for (int p = segment.start; p < end; p++) {
+        target->setPixelColor(p - segment.start + offset, previous->pixels[p]);
+      }
+    }
+  }
+}
+
+void resetScene(StripData* out, const StripData* previous, const struct_message& cfg, bool newScene, int64_t nowUs) {
+  if (newScene) {
+    // The scene before the outgoing one is gone for good; its slots go to the new scene
+    releaseScene(outgoingScene);
+    SceneInstances* swap = outgoingScene;
+    outgoingScene = currentScene;
+    currentScene = swap;
+    acquireScene(currentScene, cfg);
+  }
+
+  if (cfg.segmentCount > 0) {
+    resetSegments(out, previous, cfg, newScene, nowUs);
+    return;
+  }
+
+  StripData* base = out;
+  if (cfg.layerCount > 0) {
+    base = baseFrame;
+    base->resize(out->pixelCount);
+    base->clear();
+    for (int i = 0; i < cfg.layerCount; i++) {
+      layerFrames[i]->resize(out->pixelCount);
+      layerFrames[i]->clear();
+    }
+  }
+
+  // Inheriting modes (shift, breath, heartbeat) pick up where the previous scene left off
+  if ((modeTable[cfg.modeId].flags & MODE_INHERITS) && previous) {
+    int count = min(previous->pixelCount, base->pixelCount);
+    for (int i = 0; i < count; i++) {
+      base->setPixelColor(i, previous->pixels[i]);
+    }
+  }
+}
+
+static inline uint32_t blendLayer(uint32_t below, uint32_t layer, uint8_t blend, uint8_t opacity) {
+  switch (blend) {
+    case BLEND_ADD: {
+      if (opacity != 255) layer = blendPixels(0, layer, opacity);
+      // Add red/blue and green in two lanes, then turn each lane's carry bit into 0xFF
+      uint32_t rb = (below & 0xFF00FF) + (layer & 0xFF00FF);
+      uint32_t g = (below & 0x00FF00) + (layer & 0x00FF00);
+      uint32_t rbCarry = rb & 0x1000100;
+      uint32_t gCarry = g & 0x10000;
+      rb |= rbCarry - (rbCarry >> 8);
+      g |= gCarry - (gCarry >> 8);
+      return (rb & 0xFF00FF) | (g & 0x00FF00);
+    }
+    case BLEND_MAX: {
+      if (opacity != 255) layer = blendPixels(0, layer, opacity);
+      uint32_t r = max(below & 0xFF0000, layer & 0xFF0000);
+      uint32_t g = max(below & 0x00FF00, layer & 0x00FF00);
+      uint32_t b = max(below & 0x0000FF, layer & 0x0000FF);
+      return r | g | b;
+    }
+    case BLEND_ALPHA:
+      return layer ? blendPixels(below, layer, opacity) : below;
+    case BLEND_MULTIPLY: {
+      uint32_t r = ((((below >> 16) & 0xFF) * (((layer >> 16) & 0xFF) + 1)) >> 8) << 16;
+      uint32_t g = ((((below >> 8) & 0xFF) * (((layer >> 8) & 0xFF) + 1)) >> 8) << 8;
+      uint32_t b = ((below & 0xFF) * ((layer & 0xFF) + 1)) >> 8;
+      return blendPixels(below, r | g | b, opacity);
+    }
+  }
+  return below;
+}
+
+// Scale an envelope segment's source into its range of out. Only rewritten when the source or the
+// envelope moved.
+static void applySegmentEnvelope(StripData* out, int start, const StripData* source, int i) {
+  uint8_t level = currentScene->segments[i]->frame.envelope;
+  if (!source->isDirty() && level == segmentEnvelopes[i]) return;
+  for (int p = 0; p < source->pixelCount; p++) {
+    out->setPixelColor(start + p, level == 255 ? source->pixels[p] : blendPixels(0, source->pixels[p], level));
+  }
+  segmentEnvelopes[i] = level;
+}
+
+// Each segment draws into a view of its range of out. Views share out's pixels, so only their dirty
+// spans need carrying over; envelope segments draw into their source frame instead. Static
+// segments skip rendering until the next update. The settings were expanded by resetSegments and
+// are not slewed, so a segment jumps to new parameter values on the restart they cause.
+static void renderSegments(StripData* out, const struct_message& cfg, int64_t nowUs) {
+  uint32_t now = (uint32_t)(nowUs / 1000);
+  for (int i = 0; i < cfg.segmentCount; i++) {
+    const SegmentConfig& segment = cfg.segments[i];
+    int length = segmentLength(segment, out);
+    if (length == 0) continue;
+
+    struct_message& settings = segmentSettings[i];
+    settings.updated = cfg.updated;
+    if (!cfg.updated) {
+      if (modeTable[segment.modeId].flags & MODE_STATIC) continue;
+      if ((int32_t)(now - segmentNextMs[i]) < 0) continue;
+    }
+    segmentNextMs[i] = now + segmentFrameMs(segment);
+
+    bool envelope = modeTable[segment.modeId].flags & MODE_ENVELOPE;
+    StripData* view = segmentViews[i];
+    view->pixels = envelope ? segmentSources[i]->pixels : out->pixels + segment.start;
+    view->pixelCount = view->capacity = length;
+    view->clearDirty();
+    callModeFunction(segment.modeId, view, &settings, currentScene->segments[i], nowUs);
+    if (envelope) {
+      applySegmentEnvelope(out, segment.start, view, i);
+    } else if (view->isDirty()) {
+      out->markDirty(segment.start + view->dirtyStart, segment.start + view->dirtyEnd);
+    }
+  }
+}
+
+void renderScene(StripData* out, const struct_message& cfg, int64_t nowUs) {
+  if (cfg.segmentCount > 0) {
+    renderSegments(out, cfg, nowUs);
+    return;
+  }
+  uint8_t moved = changedParams(renderedSettings, cfg);
+  cloneData(cfg, renderedSettings);
+  if (cfg.layerCount == 0) {
+    renderMode(cfg.modeId, out, cfg, currentScene->base, moved, nowUs);
+    return;
+  }
+
+  fitFrame(baseFrame, out->pixelCount);
+  renderMode(cfg.modeId, baseFrame, cfg, currentScene->base, moved, nowUs);
+  int start = baseFrame->dirtyStart;
+  int end = baseFrame->dirtyEnd;
+  for (int i = 0; i < cfg.layerCount; i++) {
+    fitFrame(layerFrames[i], out->pixelCount);
+    renderMode(cfg.layers[i].modeId, layerFrames[i], cfg, currentScene->layers[i], moved, nowUs);
+    start = min(start, layerFrames[i]->dirtyStart);
+    end = max(end, layerFrames[i]->dirtyEnd);
+  }
+  end = min(end, out->pixelCount - 1);
+
+  // Single pass over the union of what changed: each output pixel reads every layer once
+  const uint32_t* base = baseFrame->pixels;
+  const uint32_t* layers[MAX_LAYERS];
+  for (int i = 0; i < cfg.layerCount; i++) layers[i] = layerFrames[i]->pixels;
+  for (int p = start; p <= end; p++) {
+    uint32_t c = base[p];
+    for (int i = 0; i < cfg.layerCount; i++) {
+      c = blendLayer(c, layers[i][p], cfg.layers[i].blend, cfg.layers[i].opacity);
+    }
+    out->setPixelColor(p, c);
+  }
+
+  baseFrame->clearDirty();
+  for (int i = 0; i < cfg.layerCount; i++) layerFrames[i]->clearDirty();
+}
+
+// Render cost of a whole scene, from the per-mode measurements
+static uint32_t sceneCostUs(const struct_message& cfg) {
+  uint32_t cost = 0;
+  if (cfg.segmentCount > 0) {
+    for (int i = 0; i < cfg.segmentCount; i++) cost += modeCostUs(cfg.segments[i].modeId, cfg.segments[i].length);
+    return cost;
+  }
+  cost = modeCostUs(cfg.modeId, cfg.ledCount);
+  for (int i = 0; i < cfg.layerCount; i++) cost += modeCostUs(cfg.layers[i].modeId, cfg.ledCount);
+  return cost;
+}
+
+void beginTransition(StripData* old, const struct_message& oldCfg, const struct_message& cfg) {
+  transitionPolicy = TRANSITION_SNAPSHOT;
+  transitionStride = 1;
+  transitionStep = 0;
+  bool animated = oldCfg.layerCount == 0 && oldCfg.segmentCount == 0 && !(modeTable[oldCfg.modeId].flags & MODE_STATIC);
+  if (!animated) return;
+
+  // Whatever the new scene leaves of the budget goes to the old one
+  uint32_t budget = (uint32_t)min(sceneFrameMs(cfg), sceneFrameMs(oldCfg)) * 1000 * TRANSITION_BUDGET_PERCENT / 100;
+  uint32_t newCost = sceneCostUs(cfg);
+  uint32_t oldCost = modeCostUs(oldCfg.modeId, old->pixelCount);
+  uint32_t headroom = budget > newCost ? budget - newCost : 0;
+  if (oldCost <= headroom) {
+    transitionPolicy = TRANSITION_DUAL;
+  } else if (headroom > 0 && (oldCost + headroom - 1) / headroom <= MAX_TRANSITION_STRIDE) {
+    transitionPolicy = TRANSITION_DECIMATED;
+    transitionStride = (oldCost + headroom - 1) / headroom;
+    for (int i = 0; i < 2; i++) {
+      oldKeys[i]->resize(old->pixelCount);
+      memcpy(oldKeys[i]->pixels, old->pixels, old->pixelCount * sizeof(uint32_t));
+    }
+  }
+
+  static const char* const policyNames[] = {"snapshot", "decimated", "dual"};
+  Serial.printf("Transition: %s x%d (old %uus, new %uus, budget %uus)\n", policyNames[transitionPolicy], transitionStride,
+                oldCost, newCost, budget);
+}
+
+void renderPreviousScene(StripData* old, const struct_message& oldCfg, int64_t nowUs) {
+  if (transitionPolicy == TRANSITION_SNAPSHOT) return;
+  // A settings update mid-transition leaves oldCfg describing the running scene, not the outgoing one
+  ModeInstance* instance = outgoingScene->base;
+  if (!instance || instance->modeId != oldCfg.modeId) return;
+
+  if (transitionPolicy == TRANSITION_DUAL) {
+    callModeFunction(oldCfg.modeId, old, &oldCfg, instance, nowUs);
+    return;
+  }
+
+  if (++transitionStep >= transitionStride) {
+    transitionStep = 0;
+    memcpy(oldKeys[0]->pixels, oldKeys[1]->pixels, oldKeys[1]->pixelCount * sizeof(uint32_t));
+    callModeFunction(oldCfg.modeId, oldKeys[1], &oldCfg, instance, nowUs);
+  }
+  // Trail the mode by one step so every frame lies between two rendered ones
+  uint8_t weight = (transitionStep + 1) * 255 / transitionStride;
+  const uint32_t* from = oldKeys[0]->pixels;
+  const uint32_t* to = oldKeys[1]->pixels;
+  int count = min(old->pixelCount, oldKeys[1]->pixelCount);
+  for (int i = 0; i < count; i++) {
+    old->setPixelColor(i, blendPixels(from[i], to[i], weight));
+  }
+}
+
+bool sceneChanged(const struct_message& a, const struct_message& b) {
+  if (a.modeId != b.modeId || a.layerCount != b.layerCount || a.segmentCount != b.segmentCount) return true;
+  for (int i = 0; i < a.segmentCount; i++) {
+    const SegmentConfig& sa = a.segments[i];
+    const SegmentConfig& sb = b.segments[i];
+    if (sa.modeId != sb.modeId || sa.start != sb.start || sa.length != sb.length) return true;
+  }
+  for (int i = 0; i < a.layerCount; i++) {
+    if (a.layers[i].modeId != b.layers[i].modeId) return true;
+  }
+  return false;
+}
+
+uint8_t sceneEnvelope(bool outgoing) {
+  const SceneInstances* scene = outgoing ? outgoingScene : currentScene;
+  uint32_t envelope = scene->base ? scene->base->frame.envelope : 255;
+  for (int i = 0; i < MAX_LAYERS; i++) {
+    if (scene->layers[i]) envelope = envelope * scene->layers[i]->frame.envelope / 255;
+  }
+  return envelope;
+}
+
+bool sceneNeedsRedraw(const struct_message& a, const struct_message& b) {
+  if (sceneChanged(a, b) || a.ledCount != b.ledCount) return true;
+  // Segments take their parameters from their own config only, which is expanded on a restart
+  if (b.segmentCount > 0) {
+    for (int i = 0; i < b.segmentCount; i++) {
+      if (changedParams(a.segments[i], b.segments[i]) & modeTable[b.segments[i].modeId].params) return true;
+    }
+    return false;
+  }
+  // The base and layer modes render from the slewed settings and follow everything else as it moves
+  uint8_t restarts = modeTable[b.modeId].restarts;
+  for (int i = 0; i < b.layerCount; i++) {
+    if (a.layers[i].blend != b.layers[i].blend || a.layers[i].opacity != b.layers[i].opacity) return true;
+    restarts |= modeTable[b.layers[i].modeId].restarts;
+  }
+  return changedParams(a, b) & restarts;
+}
+
+uint16_t sceneFrameMs(const struct_message& cfg) {
+  if (cfg.segmentCount > 0) {
+    uint16_t period = UINT16_MAX;
+    for (int i = 0; i < cfg.segmentCount; i++) {
+      period = min(period, segmentFrameMs(cfg.segments[i]));
+    }
+    return period;
+  }
+  uint16_t period = modeTable[cfg.modeId].frameMs;
+  for (int i = 0; i < cfg.layerCount; i++) {
+    period = min(period, (uint16_t)modeTable[cfg.layers[i].modeId].frameMs);
+  }
+  return period;
+}
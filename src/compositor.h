@@ -0,0 +1,63 @@
+#ifndef COMPOSITOR_H
+#define COMPOSITOR_H
+
+#include "lighting.h"
+
+// Scene compositor. A scene is the base mode (lightMode) with up to MAX_LAYERS modes stacked on
+// top, each combined with a LayerBlend. Every layer keeps rendering into its own pool frame, since
+// modes build on their previous output, and the stack is merged into the output frame in one pass
+// over the pixels that changed. A scene without layers renders its mode straight into the output.
+//
+// Alternatively a scene is split into segments: pixel ranges that each run their own mode with
+// their own parameters and render rate, drawing into views of the output frame without copying.
+// Segment parameters do not glide: the settings of each segment are expanded on a restart only.
+//
+// Every mode in a scene owns a ModeInstance. The outgoing scene keeps its instances until the
+// next scene change, so a transition can keep animating it while the new scene starts fresh.
+
+void initCompositor(const struct_message& cfg);
+
+// Start a new scene after a settings update. out has been cleared; previous is the last frame
+// shown, which MODE_INHERITS base modes start from. newScene (see sceneChanged) hands the running
+// instances to the outgoing scene and acquires fresh ones, seeded from cfg.seed; otherwise the
+// modes keep their state.
+void resetScene(StripData* out, const StripData* previous, const struct_message& cfg, bool newScene, int64_t nowUs);
+
+// Advance every mode in the scene to the frame clock nowUs and merge the result into out.
+// Static modes only repaint when cfg.updated marks a restart or a parameter they read moved since
+// the previous frame, as it does while a glide runs (see advanceSlew).
+void renderScene(StripData* out, const struct_message& cfg, int64_t nowUs);
+
+// How the outgoing scene is kept moving while the new one fades in
+enum TransitionPolicy : uint8_t {
+  TRANSITION_SNAPSHOT,  // Freeze the last frame shown
+  TRANSITION_DECIMATED, // Render every few frames and interpolate in between
+  TRANSITION_DUAL,      // Render both scenes every frame
+};
+
+// Pick the policy for a transition that just started from the measured mode costs and the frame
+// budget. old holds the outgoing scene's last frame.
+void beginTransition(StripData* old, const struct_message& oldCfg, const struct_message& cfg);
+
+// Advance the outgoing scene during a transition according to its policy. Only a plain dynamic
+// mode keeps moving: layer frames and segment views belong to the new scene.
+void renderPreviousScene(StripData* old, const struct_message& oldCfg, int64_t nowUs);
+
+// Whole-frame multiplier the output stage applies for the scene's modifier modes, the product of
+// the base and layer envelopes (255 = none). outgoing asks for the scene transitioning out.
+// Segments apply their own envelopes to their pixels and are left out.
+uint8_t sceneEnvelope(bool outgoing);
+
+// True when the two settings describe different mode stacks
+bool sceneChanged(const struct_message& a, const struct_message& b);
+
+// True when an update from a to b has to restart the scene: its mode stack or strip length changed,
+// a parameter a running mode only takes up on a restart (see ModeInfo::restarts), or one read by a
+// segment. Anything else, such as output settings or a speed the modes follow as it glides, keeps
+// the current frame and mode state.
+bool sceneNeedsRedraw(const struct_message& a, const struct_message& b);
+
+// Frame period wanted by the scene: the fastest of its modes
+uint16_t sceneFrameMs(const struct_message& cfg);
+
+#endif
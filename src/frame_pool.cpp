@@ -0,0 +1,33 @@
+#include "lighting.h"
+#include <Arduino.h>
+#include <assert.h>
+
+// Frame buffers are carved out of one block at boot so config updates never touch the heap.
+// Each is claimed once, at boot, and kept; handleStrip() swaps the current/old roles by pointer.
+static uint32_t* poolPixels = nullptr;
+static StripData* poolFrames[FRAME_POOL_SIZE];
+static bool poolInUse[FRAME_POOL_SIZE];
+
+void initFramePool() {
+  if (poolPixels) return;
+  poolPixels = new uint32_t[FRAME_POOL_SIZE * MAX_LED_COUNT];
+  for (int i = 0; i < FRAME_POOL_SIZE; i++) {
+    poolFrames[i] = new StripData(poolPixels + i * MAX_LED_COUNT, MAX_LED_COUNT);
+    poolInUse[i] = false;
+  }
+}
+
+StripData* acquireFrame(int pixelCount) {
+  for (int i = 0; i < FRAME_POOL_SIZE; i++) {
+    if (!poolInUse[i]) {
+      poolInUse[i] = true;
+      poolFrames[i]->resize(pixelCount);
+      poolFrames[i]->clear();
+      return poolFrames[i];
+    }
+  }
+  // FRAME_POOL_SIZE counts every claim made at boot, so running out means a new claim was not counted
+  Serial.println(F("Frame pool exhausted"));
+  assert(!"FRAME_POOL_SIZE is missing a frame");
+  return nullptr;
+}
@@ -2,32 +2,53 @@
 #define LIGHTING_EFFECTS_H
 
 #include <Arduino.h>
+#include <limits.h>
+#include <new>
+#include <type_traits>
 #include <Adafruit_NeoPixel.h>
 #include "communications.h"
 
 // Strip data structure to hold RGB values for each pixel
+// Frames from the frame pool wrap a preallocated buffer and can be resized up to their capacity.
+// Every write path records the span of pixels changed since the output stage last encoded the frame;
+// code writing pixels[] directly must call markDirty() itself.
 struct StripData {
   uint32_t* pixels;
   int pixelCount;
+  int capacity;
+  bool ownsPixels;
+  int dirtyStart; // First changed pixel (dirtyStart > dirtyEnd when clean)
+  int dirtyEnd;   // Last changed pixel
   
-  StripData(int count) : pixelCount(count) {
+  StripData(int count) : pixelCount(count), capacity(count), ownsPixels(true) {
     pixels = new uint32_t[count];
     clear();
   }
+
+  StripData(uint32_t* buffer, int bufferCapacity) : pixels(buffer), pixelCount(bufferCapacity), capacity(bufferCapacity), ownsPixels(false) {
+    clear();
+  }
   
   ~StripData() {
-    delete[] pixels;
+    if (ownsPixels) delete[] pixels;
+  }
+
+  void resize(int count) {
+    pixelCount = constrain(count, 0, capacity);
+    markAllDirty();
   }
   
   void clear() {
     for (int i = 0; i < pixelCount; i++) {
       pixels[i] = 0;
     }
+    markAllDirty();
   }
   
   void setPixelColor(int index, uint32_t color) {
-    if (index >= 0 && index < pixelCount) {
+    if (index >= 0 && index < pixelCount && pixels[index] != color) {
       pixels[index] = color;
+      markDirty(index);
     }
   }
   
@@ -37,8 +58,128 @@ struct StripData {
     }
     return 0;
   }
+
+  void markDirty(int start, int end) {
+    if (start < dirtyStart) dirtyStart = start;
+    if (end > dirtyEnd) dirtyEnd = end;
+  }
+  void markDirty(int index) { markDirty(index, index); }
+  void markAllDirty() { dirtyStart = 0; dirtyEnd = pixelCount - 1; }
+  bool isDirty() const { return dirtyStart <= dirtyEnd; }
+  void clearDirty() { dirtyStart = INT_MAX; dirtyEnd = -1; }
+};
+
+// Opt-in dual-core render/output pipeline, see pipeline.h
+#ifndef DUAL_CORE_PIPELINE
+#define DUAL_CORE_PIPELINE 0
+#endif
+
+// Frame pool - MAX_LED_COUNT sized frames allocated once at boot, one per claim made during setup:
+// current + old (transition source), the compositor's base and layer frames, the two key frames of
+// a decimated transition, plus the pipeline's triple buffer when enabled
+constexpr int FRAME_POOL_SIZE = 2 + 1 + MAX_LAYERS + 2 + (DUAL_CORE_PIPELINE ? 3 : 0);
+void initFramePool();
+// Claim a frame for good; asserts (and returns nullptr) once the pool is used up
+StripData* acquireFrame(int pixelCount);
+
+// Per-frame inputs of a mode: the frame clock and a seeded random stream. Modes take time and
+// randomness only from here, never from millis()/random(), so the same seed, settings and clock
+// reproduce the same frames - offline, ahead of time or on several nodes at once.
+struct FrameContext {
+  int64_t nowUs;     // Frame timestamp: esp_timer_get_time() when live, simulated when rendering offline
+  uint32_t nowMs;    // nowUs in ms, for modes that time whole phases
+  uint32_t dtUs;     // Since this instance's previous frame (0 on its first); motion is velocity x dtUs
+  uint32_t rngState; // xorshift32 state, never 0
+  uint8_t envelope;  // Whole-frame multiplier a modifier mode sets for the output stage (255 = none)
+
+  uint32_t next() {
+    uint32_t x = rngState;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return rngState = x;
+  }
+  // Same ranges as Arduino's random(): [0, howBig) and [howSmall, howBig)
+  long random(long howBig) { return howBig > 0 ? (long)(next() % (uint32_t)howBig) : 0; }
+  long random(long howSmall, long howBig) { return howSmall >= howBig ? howSmall : howSmall + random(howBig - howSmall); }
+};
+
+// Fixed-rate stepping for modes that move in whole steps (a pixel, a palette entry, a fade pass):
+// a step falls due every stepUs of frame time however the frames are spaced, and the remainder
+// carries into the next frame. Step counts at a given time are the same at any frame rate.
+constexpr uint32_t MAX_CATCHUP_STEPS = 32; // Replayed at most after a stall; the rest is dropped
+
+struct StepClock {
+  uint32_t carryUs = 0;
+  bool started = false;
+
+  // Steps due this frame. The first call yields one so a mode draws as soon as it starts.
+  uint32_t advance(uint32_t dtUs, uint32_t stepUs) {
+    if (!started) {
+      started = true;
+      return 1;
+    }
+    if (stepUs == 0) return 1;
+    uint64_t elapsed = (uint64_t)carryUs + dtUs;
+    uint64_t steps = elapsed / stepUs;
+    carryUs = elapsed % stepUs;
+    return steps > MAX_CATCHUP_STEPS ? MAX_CATCHUP_STEPS : (uint32_t)steps;
+  }
+};
+
+// Mode instances - every running mode owns one slot of a fixed arena and keeps its state there
+// instead of in function-local statics, so the same mode can run in two layers, segments or
+// both sides of a transition without the copies trampling each other. Slots are sized for two
+// full scenes (current + outgoing). Per-pixel buffers come from a scratch arena shared by all
+// slots and allocated at boot, so modes never allocate and leave nothing behind on exit. Only the
+// few modes that keep per-pixel history claim from it, by size, so it holds one full-strip
+// 32-bit buffer per scene.
+constexpr int MODE_STATE_SIZE = 256;
+constexpr int MODE_SCRATCH_ARENA_SIZE = 2 * MAX_LED_COUNT * sizeof(uint32_t);
+constexpr int MAX_MODE_INSTANCES = 2 * (1 + MAX_LAYERS > MAX_SEGMENTS ? 1 + MAX_LAYERS : MAX_SEGMENTS);
+
+struct ModeInstance {
+  int modeId;
+  bool constructed;
+  bool entered;    // enter hook has run
+  int pixelCount;  // Frame size the mode last rendered at, to detect resizes
+  uint8_t* scratchBase; // This instance's claim on the scratch arena, nullptr until first used
+  size_t scratchSize;
+  FrameContext frame; // Clock and random stream handed to the mode each frame
+  alignas(8) uint8_t state[MODE_STATE_SIZE];
+
+  // The mode's state struct, default-constructed on first use after the slot was acquired.
+  // Slots are recycled without running destructors, so state must not own resources.
+  template <typename T>
+  T& get() {
+    static_assert(sizeof(T) <= MODE_STATE_SIZE, "Mode state does not fit MODE_STATE_SIZE");
+    static_assert(std::is_trivially_destructible<T>::value, "Mode state must be trivially destructible");
+    if (!constructed) {
+      new (state) T();
+      constructed = true;
+    }
+    return *reinterpret_cast<T*>(state);
+  }
+
+  // count elements of scratch, or nullptr when the arena has no room for them. The claim grows
+  // when a larger count is asked for, which moves it. Contents are left as the previous owner
+  // wrote them; modes clear what they use in their enter/resize hooks.
+  template <typename T>
+  T* scratch(int count) {
+    if (count < 0) return nullptr;
+    if (count * sizeof(T) > scratchSize && !claimScratch(count * sizeof(T))) return nullptr;
+    return reinterpret_cast<T*>(scratchBase);
+  }
+
+ private:
+  bool claimScratch(size_t bytes);
 };
 
+void initModeInstances();
+// seed starts the instance's random stream
+ModeInstance* acquireModeInstance(int modeId, uint32_t seed);
+void releaseModeInstance(ModeInstance* instance);
+
 extern struct_message myData;
 extern Adafruit_NeoPixel strip;
 
@@ -46,27 +187,124 @@ extern Adafruit_NeoPixel strip;
 extern StripData* stripData;
 extern StripData* stripDataOld;
 
-// Transition management
+// Transition management (255 = fully old frame, counts down to 0)
 extern int transitionValue; 
 
+// Crossfade two packed 0xRRGGBB colors with a 0-255 weight (255 is fully color2).
+// Red and blue share one multiply-accumulate (SWAR, 16-bit lanes), green takes another; no division.
+inline uint32_t blendPixels(uint32_t color1, uint32_t color2, uint8_t weight) {
+  uint32_t w2 = weight + (weight >> 7); // 0-256 so 255 lands exactly on color2
+  uint32_t w1 = 256 - w2;
+  uint32_t rb = ((color1 & 0xFF00FF) * w1 + (color2 & 0xFF00FF) * w2) >> 8;
+  uint32_t g  = ((color1 & 0x00FF00) * w1 + (color2 & 0x00FF00) * w2) >> 8;
+  return (rb & 0xFF00FF) | (g & 0x00FF00);
+}
+
+// Linear-light crossfade: channels are mixed after decoding gamma through lookup tables
+void initBlendTables();
+uint32_t blendPixelsLinear(uint32_t color1, uint32_t color2, uint8_t weight);
+
+// 8-bit gamma 2.2 curve for modes that shape brightness themselves, built with the blend tables
+extern uint8_t gamma22[256];
+
 // Utility functions
 uint32_t Wheel(byte WheelPos);
-StripData* createColoredStripData(int pixelCount, uint32_t color);
-StripData* cloneStripData(StripData* source);
-uint32_t randomColor();
-
-// Effect functions
-StripData* effect_static(uint32_t color);
-StripData* effect_fade(StripData* data, unsigned intensity);
-StripData* effect_range(StripData* data, int startPixel, int endPixel, unsigned fadeIntensity);
-StripData* effect_shift(StripData* data, unsigned direction);
-StripData* effect_blink(StripData* sourceData, StripData* backgroundData, uint32_t blinkInterval);
-StripData* effect_swipe(StripData* data, unsigned direction, uint32_t color, int* overridePixelIndex = nullptr);
-StripData* effect_sweep(StripData* data, unsigned direction, uint32_t color, unsigned dragLength, unsigned count = 1, int* overridePixelIndex = nullptr);
-StripData* effect_breath(StripData* data, unsigned intensity);
-
-
-// Effect dispatcher function
-void callModeFunction(const String& effect, StripData* data, const struct_message* config = nullptr);
+uint32_t randomColor(FrameContext& frame);
+
+// Cursors for the stateful effects; the calling mode keeps them in its instance state
+struct BlinkCursor {
+  StepClock toggles;
+  bool isOn = true;
+};
+
+struct SwipeCursor {
+  int pixel = 0;
+};
+
+struct SweepCursor {
+  int pixel = 0;
+  int bounceDirection = 1; // 1 for forward, -1 for backward
+};
+
+// Effect functions - modify the given StripData in place
+void effect_static(StripData* data, uint32_t color);
+void effect_fade(StripData* data, unsigned intensity);
+void effect_range(StripData* data, int startPixel, int endPixel, unsigned fadeIntensity);
+void effect_shift(StripData* data, unsigned direction);
+bool effect_blink(StripData* data, BlinkCursor* cursor, uint32_t dtUs, uint32_t onColor, uint32_t offColor, uint32_t blinkInterval);
+void effect_swipe(StripData* data, SwipeCursor* cursor, unsigned direction, uint32_t color, int* overridePixelIndex = nullptr);
+void effect_sweep(StripData* data, SweepCursor* cursor, unsigned direction, uint32_t color, unsigned dragLength, unsigned count = 1, int* overridePixelIndex = nullptr, bool overlay = false);
+
+
+// Mode registry - lightMode names are resolved to an index into modeTable once, when they are received
+typedef void (*ModeFunction)(StripData* data, const struct_message* config, ModeInstance* instance, FrameContext& frame);
+
+// Lifecycle hooks, all optional. enter runs before the first render of an instance and resize
+// before the first render at a new pixel count, both with the frame about to be drawn. exit runs
+// when the instance is released, after which its state and scratch go to the next mode.
+typedef void (*ModeHook)(StripData* data, const struct_message* config, ModeInstance* instance, FrameContext& frame);
+typedef void (*ModeExitHook)(ModeInstance* instance);
+
+enum ModeFlags : uint8_t {
+  MODE_STATIC   = 1 << 0, // Passive: only rendered when the config is updated
+  MODE_INHERITS = 1 << 1, // Starts from the previous mode's pixels instead of a blank frame
+  MODE_ENVELOPE = 1 << 2, // Modulates the frame through FrameContext::envelope and leaves its pixels alone
+};
+
+// Rough render cost per pixel, standing in for the measured cost until a mode has run
+enum ModeCost : uint8_t {
+  COST_LIGHT,  // Fills and copies
+  COST_MEDIUM, // Per-pixel fades and blends
+  COST_HEAVY,  // Per-pixel noise, trigonometry or palette math
+};
+
+// The struct_message mode parameters a mode reads. A settings update that only touches
+// parameters outside the running modes' masks leaves the frame and the mode state alone, and so
+// does one to parameters a mode follows while running; see ModeInfo::restarts.
+enum ModeParams : uint8_t {
+  PARAM_SPEED       = 1 << 0,
+  PARAM_INTENSITY   = 1 << 1,
+  PARAM_DIRECTION   = 1 << 2,
+  PARAM_COUNT       = 1 << 3,
+  PARAM_COLOR_ONE   = 1 << 4,
+  PARAM_COLOR_TWO   = 1 << 5,
+  PARAM_COLOR_THREE = 1 << 6,
+};
+
+struct ModeInfo {
+  const char* name;
+  ModeFunction function;
+  uint8_t flags;
+  uint8_t frameMs; // Target frame period for the scheduler
+  uint8_t cost;    // ModeCost
+  uint8_t params;  // ModeParams it reads
+  uint8_t restarts; // ModeParams it only takes up when it starts; changing one restarts the scene
+  ModeHook enter;
+  ModeExitHook exit;
+  ModeHook resize;
+};
+
+constexpr int MODE_UNKNOWN = -1;
+extern const ModeInfo modeTable[];
+extern const int modeCount;
+
+int findModeId(const char* name);
+
+// Effect dispatcher function - instance is the arena slot holding this copy of the mode's state.
+// Runs the enter/resize hooks first when they are due. nowUs is the frame clock.
+void callModeFunction(int modeId, StripData* data, const struct_message* config, ModeInstance* instance, int64_t nowUs);
+
+// Render a mode on a simulated clock as fast as the CPU allows: frameCount frames frameUs apart,
+// starting at startUs, with the random stream seeded by seed. onFrame sees each finished frame.
+// Identical arguments give identical frames. Returns false when no mode instance was free.
+// Modifier modes leave the pixels alone; their envelope is an output-stage multiplier and is not
+// applied to the frames.
+typedef void (*FrameCallback)(const StripData* frame, int index, void* user);
+bool renderModeOffline(int modeId, StripData* out, const struct_message& cfg, uint32_t seed, int64_t startUs,
+                       uint32_t frameUs, int frameCount, FrameCallback onFrame, void* user);
+
+// Render time of a mode over pixelCount pixels in microseconds, from the smoothed per-pixel cost
+// measured by callModeFunction. Until it has run, estimated from its cost class.
+uint32_t modeCostUs(int modeId, int pixelCount);
 
 #endif
\ No newline at end of file
@@ -16,214 +16,186 @@ uint32_t Wheel(byte WheelPos) {
   return strip.Color(WheelPos * 3, 255 - WheelPos * 3, 0);
 }
 
-StripData* createColoredStripData(int pixelCount, uint32_t color) {
-  StripData* newData = new StripData(pixelCount);
-  for (int i = 0; i < pixelCount; i++) {
-    newData->setPixelColor(i, color);
-  }
-  return newData;
+uint32_t randomColor(FrameContext& frame) {
+  return strip.Color(frame.random(0, 255), frame.random(0, 255), frame.random(0, 255));
 }
 
-StripData* cloneStripData(StripData* source) {
-  StripData* clone = new StripData(source->pixelCount);
-  for (int i = 0; i < source->pixelCount; i++) {
-    clone->setPixelColor(i, source->getPixelColor(i));
+// Gamma 2.2 <-> 12-bit linear tables for linear-light blending, built once at boot
+static uint16_t toLinear[256];
+static uint8_t toGamma[4096];
+uint8_t gamma22[256];
+
+void initBlendTables() {
+  for (int i = 0; i < 256; i++) {
+    toLinear[i] = (uint16_t)(powf(i / 255.0f, 2.2f) * 4095.0f + 0.5f);
+    gamma22[i] = (uint8_t)(powf(i / 255.0f, 2.2f) * 255.0f + 0.5f);
+  }
+  for (int i = 0; i < 4096; i++) {
+    toGamma[i] = (uint8_t)(powf(i / 4095.0f, 1.0f / 2.2f) * 255.0f + 0.5f);
   }
-  return clone;
 }
 
-uint32_t randomColor() {
-  return strip.Color(random(0, 255), random(0, 255), random(0, 255));
+uint32_t blendPixelsLinear(uint32_t color1, uint32_t color2, uint8_t weight) {
+  uint32_t w2 = weight + (weight >> 7);
+  uint32_t w1 = 256 - w2;
+  uint32_t r = (toLinear[(color1 >> 16) & 0xFF] * w1 + toLinear[(color2 >> 16) & 0xFF] * w2) >> 8;
+  uint32_t g = (toLinear[(color1 >> 8) & 0xFF] * w1 + toLinear[(color2 >> 8) & 0xFF] * w2) >> 8;
+  uint32_t b = (toLinear[color1 & 0xFF] * w1 + toLinear[color2 & 0xFF] * w2) >> 8;
+  return ((uint32_t)toGamma[r] << 16) | ((uint32_t)toGamma[g] << 8) | toGamma[b];
+}
+
+// Scale a packed color by factor/255
+static inline uint32_t scaleColor(uint32_t color, uint8_t factor) {
+  uint8_t r = (((color >> 16) & 0xFF) * factor) / 255;
+  uint8_t g = (((color >> 8) & 0xFF) * factor) / 255;
+  uint8_t b = ((color & 0xFF) * factor) / 255;
+  return strip.Color(r, g, b);
 }
 
 // ~~~~~~~~~~~~~~~~~
 // Effect Functions
 // ~~~~~~~~~~~~~~~~~
+//
+// Effects write directly into the StripData they are given and never allocate.
 
-StripData* effect_static(uint32_t color) { 
-  StripData* result = createColoredStripData(myData.pixelCount, color); 
-  return result;
+// Fill the whole strip with a single color
+void effect_static(StripData* data, uint32_t color) {
+  for (int i = 0; i < data->pixelCount; i++) {
+    data->pixels[i] = color;
+  }
+  data->markAllDirty();
 }
 
 // Fade effect - dims colors  (0-100%) based on intensity value
-StripData* effect_fade(StripData* data, unsigned intensity) { 
-  StripData* result = cloneStripData(data);
+void effect_fade(StripData* data, unsigned intensity) {
   uint8_t fadeFactor = map(intensity, 0, 100, 0, 255); // (0-255)
-  
-  for (int i = 0; i < result->pixelCount; i++) {
-    uint32_t color = result->getPixelColor(i);
-    
-    // Extract RGB components
-    uint8_t r = (color >> 16) & 0xFF;
-    uint8_t g = (color >> 8) & 0xFF;
-    uint8_t b = color & 0xFF;
-    
-    // Apply fade factor
-    r = (r * fadeFactor) / 255;
-    g = (g * fadeFactor) / 255;
-    b = (b * fadeFactor) / 255;
-    
-    result->setPixelColor(i, strip.Color(r, g, b));
+
+  for (int i = 0; i < data->pixelCount; i++) {
+    data->pixels[i] = scaleColor(data->pixels[i], fadeFactor);
   }
-  return result;
+  data->markAllDirty();
 }
 
 // Percentage effect - Fades out of range LEDs based on intensity value (0-100%)
-StripData* effect_range(StripData* data, int startPixel, int endPixel, unsigned outOfRangeBrightness) { 
-  StripData* result = cloneStripData(data);
+void effect_range(StripData* data, int startPixel, int endPixel, unsigned outOfRangeBrightness) {
   // Ensure valid range
   if (startPixel < 0) startPixel = 0;
-  if (endPixel >= result->pixelCount) endPixel = result->pixelCount - 1;
+  if (endPixel >= data->pixelCount) endPixel = data->pixelCount - 1;
   if (startPixel > endPixel) {
     int temp = startPixel;
     startPixel = endPixel;
     endPixel = temp;
   }
-  
+
   // Calculate brightness factor for pixels outside the range
   uint8_t brightnessFactor = map(outOfRangeBrightness, 0, 100, 0, 255);
-  
+
   // Apply brightness to pixels outside the specified range
-  for (int i = 0; i < result->pixelCount; i++) {
-    if (i < startPixel || i > endPixel) {
-      uint32_t color = result->getPixelColor(i);
-      
-      // Extract RGB components
-      uint8_t r = (color >> 16) & 0xFF;
-      uint8_t g = (color >> 8) & 0xFF;
-      uint8_t b = color & 0xFF;
-      
-      // Apply brightness factor
-      r = (r * brightnessFactor) / 255;
-      g = (g * brightnessFactor) / 255;
-      b = (b * brightnessFactor) / 255;
-      
-      result->setPixelColor(i, strip.Color(r, g, b));
-    }
-    // Pixels in range keep their original color (no change needed)
+  // Pixels in range keep their original color (no change needed)
+  for (int i = 0; i < startPixel; i++) {
+    data->pixels[i] = scaleColor(data->pixels[i], brightnessFactor);
+  }
+  for (int i = endPixel + 1; i < data->pixelCount; i++) {
+    data->pixels[i] = scaleColor(data->pixels[i], brightnessFactor);
   }
-  
-  return result;
+  if (startPixel > 0) data->markDirty(0, startPixel - 1);
+  if (endPixel + 1 < data->pixelCount) data->markDirty(endPixel + 1, data->pixelCount - 1);
 }
 
-// Shift effect - shifts all pixel colors by one position
-StripData* effect_shift(StripData* data, unsigned direction) {
-  // Create a copy to return
-  StripData* result = new StripData(data->pixelCount);
-  
-  if (data->pixelCount <= 1) {
-    // If only one pixel or empty strip, just copy the data
-    for (int i = 0; i < data->pixelCount; i++) {
-      result->setPixelColor(i, data->getPixelColor(i));
-    }
-    return result;
-  }
-  
+// Shift effect - rotates all pixel colors by one position
+void effect_shift(StripData* data, unsigned direction) {
+  int last = data->pixelCount - 1;
+  if (last < 1) return; // Nothing to rotate
+
   if (direction == 1) {
     // Shift left (direction = 1)
-    for (int i = 0; i < data->pixelCount; i++) {
-      int sourceIndex = (i + 1) % data->pixelCount;
-      result->setPixelColor(i, data->getPixelColor(sourceIndex));
+    uint32_t first = data->pixels[0];
+    for (int i = 0; i < last; i++) {
+      data->pixels[i] = data->pixels[i + 1];
     }
+    data->pixels[last] = first;
   } else {
     // Shift right (direction = 0 or any other value)
-    for (int i = 0; i < data->pixelCount; i++) {
-      int sourceIndex = (i - 1 + data->pixelCount) % data->pixelCount;
-      result->setPixelColor(i, data->getPixelColor(sourceIndex));
+    uint32_t end = data->pixels[last];
+    for (int i = last; i > 0; i--) {
+      data->pixels[i] = data->pixels[i - 1];
     }
+    data->pixels[0] = end;
   }
-  
-  return result;
+  data->markAllDirty();
 }
 
-// Can do blink - returns modified stripdata copy
-StripData* effect_blink(StripData* data, StripData* data2, uint32_t blinkInterval) {
-  static unsigned long lastToggle = 0;
-  static bool isOn = true;
-  
-  uint32_t now = millis();
+// Blink between two solid colors. Returns true while showing onColor.
+bool effect_blink(StripData* data, BlinkCursor* cursor, uint32_t dtUs, uint32_t onColor, uint32_t offColor, uint32_t blinkInterval) {
   uint32_t interval = (blinkInterval > 100) ? blinkInterval : 100; // Minimum 100ms interval
-  
-  // Simple toggle logic: check if enough time has passed
-  if (now - lastToggle >= interval) {
-    isOn = !isOn;
-    lastToggle = now;
-  }
-  
-  // Create a copy to return
-  StripData* result = new StripData(data->pixelCount);
-  
-  // Set colors based on blink state
-  for (int i = 0; i < data->pixelCount; i++) {
-    result->setPixelColor(i, isOn ? data->getPixelColor(i) : (data2 ? data2->getPixelColor(i) : 0x000000));
+
+  // Toggle once per elapsed interval; an even number of toggles in one frame cancels out
+  if (cursor->toggles.advance(dtUs, interval * 1000) & 1) {
+    cursor->isOn = !cursor->isOn;
   }
-  
-  return result;
+
+  effect_static(data, cursor->isOn ? onColor : offColor);
+  return cursor->isOn;
 }
 
 // Flexible swipe effect - An LED is lit at a time, moving across the strip till it all are lit.
-StripData* effect_swipe(StripData* data, unsigned direction, uint32_t color, int* overridePixelIndex) {
-  static int pixel = 0;
-  if (overridePixelIndex) { pixel = *overridePixelIndex; }
-  
-  // Create a copy to return
-  StripData* result = new StripData(data->pixelCount); 
-  for (int i = 0; i < data->pixelCount; i++) {
-    result->setPixelColor(i, data->getPixelColor(i));
-  }
-  
-  result->setPixelColor(pixel, color);
+// Callers that place the pixel themselves through overridePixelIndex may pass no cursor.
+void effect_swipe(StripData* data, SwipeCursor* cursor, unsigned direction, uint32_t color, int* overridePixelIndex) {
+  SwipeCursor scratch;
+  if (!cursor) cursor = &scratch;
+  if (overridePixelIndex) { cursor->pixel = *overridePixelIndex; }
+
+  data->setPixelColor(cursor->pixel, color);
   // Move to next pixel based on direction
-  pixel = (pixel + (direction == 1 ? -1 : 1) + data->pixelCount) % data->pixelCount;
-  
-  return result;
+  cursor->pixel = (cursor->pixel + (direction == 1 ? -1 : 1) + data->pixelCount) % data->pixelCount;
 }
 
 // Sweep - n leds are lit at a time, moving across the strip without changing colors for good.
-StripData* effect_sweep(StripData* data, unsigned direction, uint32_t color, unsigned intensity, unsigned count, int* overridePixelIndex) {
-  static int pixel = 0;
-  static int bounceDirection = 1; // 1 for forward, -1 for backward
-  
-  if (overridePixelIndex) { 
-    pixel = *overridePixelIndex; 
+// With overlay set the strip is not cleared and pixels already lit are averaged with the sweep.
+void effect_sweep(StripData* data, SweepCursor* cursor, unsigned direction, uint32_t color, unsigned intensity, unsigned count, int* overridePixelIndex, bool overlay) {
+  int& pixel = cursor->pixel;
+  int& bounceDirection = cursor->bounceDirection;
+
+  if (overridePixelIndex) {
+    pixel = *overridePixelIndex;
     bounceDirection = 1; // Reset bounce direction when pixel is overridden
   }
-  
-  // Create a copy to return
-  StripData* result = new StripData(data->pixelCount);
-  
+
   // Clear all pixels first (sweep shows only intensity pixels at a time)
-  for (int i = 0; i < data->pixelCount; i++) {
-    result->setPixelColor(i, 0x000000);
+  if (!overlay) {
+    effect_static(data, 0x000000);
   }
-  
+
   // Calculate spacing between instances
   int spacing = count > 1 ? data->pixelCount / count : data->pixelCount;
-  
+
   // Create multiple sweep instances
   for (unsigned instance = 0; instance < count; instance++) {
     int basePixel = (pixel + instance * spacing) % data->pixelCount;
-    
+
     // Set the current pixel and trailing pixels based on intensity for this instance
     for (unsigned i = 0; i < intensity && i < (unsigned)data->pixelCount; i++) {
       int pixelIndex = (basePixel - i + data->pixelCount) % data->pixelCount;
-      
+
       // Calculate fade intensity for trailing pixels (full brightness for main pixel, dimmer for trail)
       uint8_t fadeIntensity = 255 - (i * 255 / intensity);
-      
-      // Extract RGB components and apply fade
-      uint8_t r = (color >> 16) & 0xFF;
-      uint8_t g = (color >> 8) & 0xFF;
-      uint8_t b = color & 0xFF;
-      
-      r = (r * fadeIntensity) / 255;
-      g = (g * fadeIntensity) / 255;
-      b = (b * fadeIntensity) / 255;
-
-      result->setPixelColor(pixelIndex, strip.Color(r, g, b));
+      uint32_t trail = scaleColor(color, fadeIntensity);
+
+      uint32_t existing = data->pixels[pixelIndex];
+      if (overlay && existing != 0 && trail != 0) {
+        // Average the colors where two sweeps overlap
+        uint8_t r = (((existing >> 16) & 0xFF) + ((trail >> 16) & 0xFF)) / 2;
+        uint8_t g = (((existing >> 8) & 0xFF) + ((trail >> 8) & 0xFF)) / 2;
+        uint8_t b = ((existing & 0xFF) + (trail & 0xFF)) / 2;
+        trail = strip.Color(r, g, b);
+      } else if (overlay && trail == 0) {
+        continue;
+      }
+      data->pixels[pixelIndex] = trail;
+      data->markDirty(pixelIndex);
     }
   }
-  
+
   // Move to next pixel based on direction
   if (direction == 2) {
     // Bounce mode - check for bounce before moving
@@ -232,12 +204,10 @@ StripData* effect_sweep(StripData* data, unsigned direction, uint32_t color, uns
     } else if (pixel <= 0) {
       bounceDirection = 1;
     }
-    
+
     pixel += bounceDirection;
   } else {
     // Original behavior for direction 0 and 1
     pixel = (pixel + (direction == 1 ? -1 : 1) + data->pixelCount) % data->pixelCount;
   }
-  
-  return result;
 }
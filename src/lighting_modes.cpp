@@ -44,7 +44,7 @@
 //  Modes are standalone or a combination of Effects.
 //
 //  Modes are given a pointer to the real LEDs stripData 'data' variable that update immediately.
-//  Effects are called by Modes and are given a copy of the LED stripData to be modified and returned to the Mode.
+//  Effects are called by Modes and modify the stripData they are given in place. They never allocate.
 //  the effects should not use struct_message config directly. those are reserved for modes
 //  
 //  config attribributes: 
@@ -52,14 +52,15 @@
 //    colorOne, colorTwo, colorThree - Users colors for some effects
 //
 //  Composability issues:
-//  - Some effects can't write directly to the stripData (eg. blink turning off loses the previous stripColors).
+//  - Some effects overwrite the whole stripData (eg. blink fills it with its on/off color).
 //  - Some effects need to be called in a specific order (eg. fade before blink).
 //  - Some effects need to be called multiple times to achieve the desired effect (eg. swipe). 
 
 // Swipe Mode - Wipes StripData on colorchange and applies new color at Stored Index. 
 // Sweep Mode - Uses a black bg.
 
-// [Shift, Breath] Inherit the previous modes colors. Do not update on color change.
+// [Shift, Breath, Heartbeat] Inherit the previous modes colors. Do not update on color change.
+// Breath and Heartbeat only set the output envelope; the colors beneath are never rescaled.
 
 //
 // Base Layer Modes
@@ -79,46 +80,109 @@
 // ~~~~~~~~~~~~~~~~~
 
 
+// Mode table - the index of each entry is the modeId stored in struct_message.
+// Order matters only for the default (index 0 = "static").
+// frameMs is the period the scheduler wakes the mode at; modes still gate their own steps on speed.
+// params must list every struct_message parameter the mode (or its hooks) reads, or updates to the
+// missing ones will not reach it. restarts lists those it only reads when it (re)starts, such as
+// colors baked into its state; changes to the others are followed while it runs.
+// Trailing enter/exit/resize hooks default to none.
+const ModeInfo modeTable[] = {
+  { "static",         mode_static,           MODE_STATIC,    50,  COST_LIGHT,   PARAM_COLOR_ONE, 0 },
+  { "statictri",      mode_static_tri,       MODE_STATIC,    50,  COST_LIGHT,   PARAM_COLOR_ONE | PARAM_COLOR_TWO | PARAM_COLOR_THREE, 0 },
+  { "percent",        mode_percent,          MODE_STATIC,    50,  COST_LIGHT,   PARAM_SPEED | PARAM_INTENSITY | PARAM_COLOR_ONE, 0 },
+  { "percenttri",     mode_percent_tri,      MODE_STATIC,    50,  COST_LIGHT,   PARAM_SPEED | PARAM_INTENSITY | PARAM_COLOR_ONE | PARAM_COLOR_TWO | PARAM_COLOR_THREE, 0 },
+  { "shift",          mode_shift,            MODE_INHERITS,  50,  COST_LIGHT,   PARAM_SPEED | PARAM_DIRECTION, 0 },
+  { "washingmachine", mode_washing_machine,  0,              40,  COST_LIGHT,   PARAM_SPEED | PARAM_INTENSITY | PARAM_DIRECTION | PARAM_COUNT | PARAM_COLOR_ONE | PARAM_COLOR_TWO, PARAM_INTENSITY | PARAM_COLOR_ONE | PARAM_COLOR_TWO },
+  { "blink",          mode_blink,            0,              50,  COST_LIGHT,   PARAM_SPEED | PARAM_COLOR_ONE, 0 },
+  { "blinktoggle",    mode_blink_toggle,     0,              50,  COST_LIGHT,   PARAM_SPEED | PARAM_COLOR_ONE | PARAM_COLOR_TWO, 0 },
+  { "blinkrandom",    mode_blink_random,     0,              50,  COST_LIGHT,   PARAM_SPEED, 0, blink_random_enter },
+  { "heartbeat",      mode_heartbeat,        MODE_INHERITS | MODE_ENVELOPE, 50,  COST_LIGHT,   PARAM_SPEED | PARAM_INTENSITY, 0 },
+  { "twinkles",       mode_twinkles,         0,              10,  COST_MEDIUM,  PARAM_SPEED | PARAM_INTENSITY | PARAM_COLOR_ONE, 0 },
+  { "swipe",          mode_swipe,            0,              50,  COST_LIGHT,   PARAM_DIRECTION | PARAM_COLOR_ONE | PARAM_COLOR_TWO, 0 },
+  { "swiperandom",    mode_swipe_random,     0,              50,  COST_LIGHT,   PARAM_DIRECTION, 0, swipe_random_enter },
+  { "colorloop",      mode_colorloop,        0,              10,  COST_MEDIUM,  PARAM_SPEED | PARAM_INTENSITY, 0 },
+  { "breath",         mode_breath,           MODE_INHERITS | MODE_ENVELOPE, 20,  COST_LIGHT,   PARAM_SPEED | PARAM_INTENSITY | PARAM_COLOR_ONE | PARAM_COLOR_TWO | PARAM_COLOR_THREE, PARAM_COLOR_ONE | PARAM_COLOR_TWO | PARAM_COLOR_THREE, breath_capture, nullptr, breath_capture },
+  { "sweep",          mode_sweep,            0,              50,  COST_MEDIUM,  PARAM_SPEED | PARAM_INTENSITY | PARAM_DIRECTION | PARAM_COUNT | PARAM_COLOR_ONE, 0 },
+  { "sweepdual",      mode_sweep_dual,       0,              50,  COST_MEDIUM,  PARAM_SPEED | PARAM_INTENSITY | PARAM_COUNT | PARAM_COLOR_ONE | PARAM_COLOR_TWO, 0 },
+  { "theater",        mode_theater,          0,              20,  COST_LIGHT,   PARAM_SPEED | PARAM_INTENSITY | PARAM_DIRECTION | PARAM_COUNT, 0 },
+  { "fireworks",      mode_fireworks,        0,              10,  COST_MEDIUM,  PARAM_SPEED | PARAM_INTENSITY | PARAM_DIRECTION | PARAM_COLOR_ONE, 0 },
+  { "juggle",         mode_juggle,           0,              10,  COST_MEDIUM,  PARAM_SPEED | PARAM_INTENSITY, 0 },
+  { "bouncingballs",  mode_bouncing_balls,   0,              10,  COST_MEDIUM,  PARAM_SPEED | PARAM_INTENSITY | PARAM_COLOR_ONE | PARAM_COLOR_TWO | PARAM_COLOR_THREE, PARAM_INTENSITY | PARAM_COLOR_ONE | PARAM_COLOR_TWO | PARAM_COLOR_THREE },
+  { "meteor",         mode_meteor,           0,              15,  COST_MEDIUM,  PARAM_SPEED | PARAM_INTENSITY | PARAM_COLOR_ONE, 0 },
+  { "tetrix",         mode_tetrix,           0,              30,  COST_MEDIUM,  PARAM_SPEED | PARAM_COLOR_ONE | PARAM_COLOR_TWO, 0, tetrix_reset, nullptr, tetrix_reset },
+  { "perlinmove",     mode_perlin_move,      0,              50,  COST_HEAVY,   PARAM_SPEED | PARAM_INTENSITY | PARAM_DIRECTION | PARAM_COLOR_ONE, PARAM_INTENSITY | PARAM_COLOR_ONE },
+  { "stream",         mode_stream,           0,              50,  COST_LIGHT,   PARAM_SPEED | PARAM_INTENSITY | PARAM_DIRECTION, 0 },
+  { "palette",        mode_palette,          0,              50,  COST_MEDIUM,  PARAM_SPEED | PARAM_INTENSITY, 0 },
+  { "plasma",         mode_plasma,           0,              10,  COST_HEAVY,   PARAM_SPEED | PARAM_INTENSITY, 0 },
+  { "pacifica",       mode_pacifica,         0,              20,  COST_HEAVY,   PARAM_SPEED | PARAM_INTENSITY | PARAM_DIRECTION | PARAM_COLOR_ONE, 0 },
+  { "sunrise",        mode_sunrise,          0,              50,  COST_MEDIUM,  PARAM_SPEED | PARAM_INTENSITY | PARAM_DIRECTION | PARAM_COLOR_ONE | PARAM_COLOR_TWO, 0 },
+  { "aurora",         mode_aurora,           0,              20,  COST_HEAVY,   PARAM_SPEED | PARAM_INTENSITY | PARAM_DIRECTION | PARAM_COLOR_ONE | PARAM_COLOR_TWO, 0 },
+  { "candle",         mode_candle,           0,              16,  COST_MEDIUM,  PARAM_SPEED | PARAM_INTENSITY | PARAM_COUNT | PARAM_COLOR_ONE, 0, candle_reset, nullptr, candle_reset },
+};
+const int modeCount = sizeof(modeTable) / sizeof(modeTable[0]);
+
+// Per-mode render cost in ns per pixel, an EWMA over the last ~8 renders. Per pixel, so a short
+// segment and a full strip running the same mode feed one comparable figure.
+static uint32_t modeCosts[sizeof(modeTable) / sizeof(modeTable[0])];
+
+// Resolve a lightMode name to its modeId. Only called when a new lightMode is received.
+int findModeId(const char* name) {
+  if (!name) return MODE_UNKNOWN;
+  for (int i = 0; i < modeCount; i++) {
+    if (strcmp(modeTable[i].name, name) == 0) return i;
+  }
+  return MODE_UNKNOWN;
+}
+
 // Called on Main Loop
-// It calls functions that modify the stripData based on the effect name.
+// It calls the mode function that modifies the stripData for the given modeId.
 // The lightstrip is then updated with the new stripData.
-//  
-// Some methods can't write directly to the stripData.
-// (eg. blink turning off looses the previous stripColors). 
-// 
-void callModeFunction(const String& effect, StripData* data, const struct_message* config) {
-  if (effect == "static") { mode_static(data, config); }
-  else if (effect == "statictri") { mode_static_tri(data, config); }
-  else if (effect == "percent") { mode_percent(data, config); }
-  else if (effect == "percenttri") { mode_percent_tri(data, config); }
-  else if (effect == "shift") { mode_shift(data, config); }
-  else if (effect == "washingmachine") { mode_washing_machine(data, config); }
-  else if (effect == "blink") { mode_blink(data, config); }
-  else if (effect == "blinktoggle") { mode_blink_toggle(data, config); }
-  else if (effect == "blinkrandom") { mode_blink_random(data, config); }
-  else if (effect == "heartbeat") { mode_heartbeat(data, config); }
-  else if (effect == "twinkles") { mode_twinkles(data, config); }
-  else if (effect == "swipe") { mode_swipe(data, config); }
-  else if (effect == "swiperandom") { mode_swipe_random(data, config); }
-  else if (effect == "colorloop") { mode_colorloop(data, config); }
-  else if (effect == "breath") { mode_breath(data, config); }
-  else if (effect == "sweep") { mode_sweep(data, config); }
-  else if (effect == "sweepdual") { mode_sweep_dual(data, config); }
-  else if (effect == "theater") { mode_theater(data, config); }
-  else if (effect == "fireworks") { mode_fireworks(data, config); }
-  else if (effect == "juggle") { mode_juggle(data, config); }
-  else if (effect == "bouncingballs") { mode_bouncing_balls(data, config); }
-  else if (effect == "meteor") { mode_meteor(data, config); }
-  else if (effect == "tetrix") { mode_tetrix(data, config); }
-  else if (effect == "perlinmove") { mode_perlin_move(data, config); }
-  else if (effect == "stream") { mode_stream(data, config); }
-  else if (effect == "palette") { mode_palette(data, config); }
-  else if (effect == "plasma") { mode_plasma(data, config); }
-  else if (effect == "pacifica") { mode_pacifica(data, config); }
-  else if (effect == "sunrise") { mode_sunrise(data, config); }
-  else if (effect == "aurora") { mode_aurora(data, config); }
-  else if (effect == "candle") { mode_candle(data, config); } 
-  else {
-    Serial.printf("Unknown effect: %s\n", effect.c_str());
+void callModeFunction(int modeId, StripData* data, const struct_message* config, ModeInstance* instance, int64_t nowUs) {
+  if (modeId < 0 || modeId >= modeCount || !instance) return;
+  const ModeInfo& mode = modeTable[modeId];
+  FrameContext& frame = instance->frame;
+  frame.dtUs = instance->entered ? (uint32_t)(nowUs - frame.nowUs) : 0;
+  frame.nowUs = nowUs;
+  frame.nowMs = (uint32_t)(nowUs / 1000);
+  if (!instance->entered) {
+    instance->entered = true;
+    instance->pixelCount = data->pixelCount;
+    if (mode.enter) mode.enter(data, config, instance, frame);
+  } else if (instance->pixelCount != data->pixelCount) {
+    instance->pixelCount = data->pixelCount;
+    if (mode.resize) mode.resize(data, config, instance, frame);
+  }
+  uint32_t start = micros();
+  mode.function(data, config, instance, frame);
+  if (data->pixelCount <= 0) return;
+  int32_t sample = (int32_t)((micros() - start) * 1000 / data->pixelCount);
+  // The first sample seeds the average; easing up from zero would underrate a mode for its first frames
+  if (!modeCosts[modeId]) modeCosts[modeId] = sample;
+  else modeCosts[modeId] += (sample - (int32_t)modeCosts[modeId]) / 8;
+}
+
+bool renderModeOffline(int modeId, StripData* out, const struct_message& cfg, uint32_t seed, int64_t startUs,
+                       uint32_t frameUs, int frameCount, FrameCallback onFrame, void* user) {
+  ModeInstance* instance = acquireModeInstance(modeId, seed);
+  if (!instance) return false;
+  struct_message settings;
+  cloneData(cfg, settings);
+  settings.updated = true; // First frame sees a fresh update, like a live mode change
+  for (int i = 0; i < frameCount; i++) {
+    callModeFunction(modeId, out, &settings, instance, startUs + (int64_t)i * frameUs);
+    settings.updated = false;
+    if (onFrame) onFrame(out, i, user);
   }
-}
\ No newline at end of file
+  releaseModeInstance(instance);
+  return true;
+}
+
+// Rough per-pixel render time of each ModeCost class in ns
+static const uint16_t costClassNs[] = {250, 1000, 4000};
+
+uint32_t modeCostUs(int modeId, int pixelCount) {
+  if (modeId < 0 || modeId >= modeCount) return 0;
+  uint32_t perPixelNs = modeCosts[modeId] ? modeCosts[modeId] : costClassNs[modeTable[modeId].cost];
+  return (uint64_t)perPixelNs * pixelCount / 1000;
+}
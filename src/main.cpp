@@ -2,10 +2,17 @@
 #include <Arduino.h>
 #include "lighting.h"
 #include "communications.h"
+#include "scheduler.h"
+#include <assert.h>
+#include "pipeline.h"
+#include "output.h"
+#include "compositor.h"
+#include "slew.h"
 
 // Available Methods: sine8(), gamma8(), str2order(), ColorHSV(), Color(), 
 // rainbow(), getPixelColor, setPixelColor, updateLength(), updateType()
 #include <Adafruit_NeoPixel.h>
+#include <esp_timer.h>
 
 // Add state tracking 
 unsigned long lastHeapCheck = 0;
@@ -14,40 +21,75 @@ void blendAndShow();
 void show();
 
 struct_message myData = {
-    20,           // brightness (of 100)
+    50,           // brightness (of 100); the current limiter keeps it under maxCurrent
     "static",      // lightMode
+    0,            // modeId (resolved from lightMode in setup)
     0xFF0000,     // colorOne (red)
     0x00FF00,     // colorTwo (green)
     0x0000FF,     // colorThree (blue)
     300,          // ledCount
-    8000,         // maxCurrent
+    8000,         // maxCurrent (mA)
+    20,           // ledMilliamps (WS2812 per channel at full)
+    1,            // idleMilliamps
     NEO_GRB + NEO_KHZ800,  // colorOrder
     15,           // pixelPin
     300,          // pixelCount
+    0,            // outputCount (single strip on pixelPin)
+    {},           // outputs
     50,           // speed (default 50)
     75,           // intensity (default 75)
     0,            // direction (default forward)
     2,            // count (default 2)
-    true          // render the initial state once on startup
+    0,            // layerCount (base mode only)
+    {},           // layers
+    0,            // segmentCount (whole strip)
+    {},           // segments
+    false,        // linearBlend (gamma-space crossfades)
+    1000,         // keepAlive (refresh an idle strip once a second)
+    10,           // gamma (none)
+    0xFFFFFF,     // colorCorrection (none)
+    false,        // dither
+    0,            // seed (fresh per scene)
+    250,          // slewMs (slider drags glide over a quarter second)
+    true,         // render the initial state once on startup
+    CHANGE_ALL    // changes (everything is new)
 }; 
 struct_message myOldData; 
-Adafruit_NeoPixel strip(myData.pixelCount, myData.pixelPin, myData.colorOrder);
+// What the modes render with: myData, with speed, intensity and colors still gliding toward it
+struct_message myLiveData;
+Adafruit_NeoPixel strip; // Color()/str2order() helpers only; pixels go out through the output driver
  
 void setup() { 
   Serial.begin(115200); 
   Serial.println(F("=== LED Strip Controller Starting ==="));
   Serial.print(F("Initial free heap: "));
   Serial.println(ESP.getFreeHeap()); 
-  strip.begin();  
-  strip.updateLength(myData.pixelCount);
-  strip.setBrightness( convertBrightness(myData.brightness) );
-  strip.clear();
-  strip.show();
+  initBlendTables();
+  myData.modeId = findModeId(myData.lightMode);
+  output = createOutputDriver();
+  OutputConfig layout[MAX_OUTPUTS];
+  output->begin(layout, outputLayout(myData, layout));
+  output->setBrightness( convertBrightness(myData.brightness) );
+  output->setGamma(myData.gamma);
+  output->setColorCorrection(myData.colorCorrection);
+  output->setDither(myData.dither);
+  output->setPowerLimit(myData.maxCurrent, myData.ledMilliamps, myData.idleMilliamps);
+  output->setKeepAlive(myData.keepAlive);
+  output->clear();
+  output->show();
   
-  // Initialize strip data arrays
-  stripData = new StripData(myData.pixelCount);
-  stripDataOld = new StripData(myData.pixelCount);
+  // Initialize strip data arrays from the preallocated frame pool
+  initFramePool();
+  initModeInstances();
+  stripData = acquireFrame(myData.pixelCount);
+  stripDataOld = acquireFrame(myData.pixelCount);
+  assert(stripData && stripDataOld);
+  initCompositor(myData);
+#if DUAL_CORE_PIPELINE
+  initPipeline();
+#endif
   cloneData(myData, myOldData);
+  cloneData(myData, myLiveData);
   // Remove: currentMode = myData.lightMode;
   
   initializeBLE(); // Initialize BLE using communication module
@@ -58,115 +100,184 @@ void setup() {
   Serial.println(F("=== Initialization Complete ==="));
 } 
 
-long oldMillis = 0; // Used to track time for loopInterval
+// Frame period requested by the running scene(s); the faster one wins during a transition
+static uint16_t framePeriodMs() {
+  uint16_t period = sceneFrameMs(myData);
+  if (transitionValue > 0) {
+    period = min(period, sceneFrameMs(myOldData));
+  }
+  return period;
+}
+
+#if !DUAL_CORE_PIPELINE
+// Print and restart the output counters, all of them produced by modeId. Called every telemetry
+// period and when the mode changes, so the bytes re-encoded per frame are reported per mode.
+static void logOutputStats(int modeId) {
+  OutputStats out = output->collectStats();
+  uint32_t shown = out.framesShown ? out.framesShown : 1;
+  uint32_t total = out.framesShown + out.framesSuppressed;
+  Serial.printf("Mode %s | shown: %u (keep-alive %u) | suppressed: %u (%u%%) | bytes/frame: %u\n", modeTable[modeId].name,
+                out.framesShown, out.keepAlives, out.framesSuppressed, total ? out.framesSuppressed * 100 / total : 0,
+                out.bytesEncoded / shown);
+  Serial.printf("Power peak: %umA | limited frames: %u\n", out.peakMilliamps, out.framesLimited);
+}
+#endif
+
 void loop() {  
-  long currentMillis = millis();    
-  if (currentMillis - oldMillis > 50 ) {
-    oldMillis = currentMillis;
-    handleStrip();
-  } 
+  waitForNextFrame(framePeriodMs());
+  handleStrip();
+
+  unsigned long currentMillis = millis();
+  if (currentMillis - lastHeapCheck > 10000) {
+    lastHeapCheck = currentMillis;
+    const FrameStats& stats = collectFrameStats();
+    Serial.printf("Heap free: %u | largest block: %u\n", ESP.getFreeHeap(), ESP.getMaxAllocHeap());
+    Serial.printf("Frames: %u | fps: %.1f | jitter mean: %uus max: %uus\n", stats.frames, stats.fps, stats.meanJitterUs, stats.maxJitterUs);
+#if DUAL_CORE_PIPELINE
+    const PipelineStats& pipeline = getPipelineStats();
+    Serial.printf("Pipeline shown: %u | dropped: %u\n", pipeline.framesShown, pipeline.framesDropped);
+#else
+    logOutputStats(myData.modeId);
+    // With the pipeline the output driver belongs to the output task
+    Serial.printf("Power: %umA of %dmA | limiter: %u/255\n", output->estimatedMilliamps(), myData.maxCurrent, output->powerLimit());
+#endif
+  }
 }
 
 // For transition blending
 StripData* stripData = nullptr;
 StripData* stripDataOld = nullptr;
 int transitionValue = 0; // Global transition state
+uint8_t envelope = 255; // Modifier modes' multiplier for the frame being shown, applied by the output stage
 
-// Helper: which effects are passive (no animation over time)
-static bool isStaticMode(const String& e) {
-  return (e == "static" || e == "statictri" || e == "percent" || e == "percenttri");
-}
-
-// callModeFn to update stripData and blend w stripDataOld.
-// SPECIAL Instructions: ["shift""] Modes Inherits the LED data from the previous mode
+// Render the scene into stripData and blend w stripDataOld.
+// SPECIAL Instructions: MODE_INHERITS modes (shift, breath, heartbeat) inherit the LED data from the previous mode
 void handleStrip() { 
+  // One clock reading per frame; every mode sees the same timestamp
+  int64_t nowUs = esp_timer_get_time();
+
   // Update strip settings.
-  if (myData.updated) { 
-    // Save the current stripData as stripDataOld, then create new stripData
-    delete stripDataOld;
-    stripDataOld = stripData;
-    stripData = new StripData(myData.ledCount);
-
-    // If switching to "shift" or "breath" mode, copy colors from old to new stripData
-    if ((String(myData.lightMode) == "shift" || String(myData.lightMode) == "breath") && stripDataOld) {
-      int count = min(stripDataOld->pixelCount, stripData->pixelCount);
-      for (int i = 0; i < count; i++) {
-        stripData->setPixelColor(i, stripDataOld->getPixelColor(i));
-      }
+  uint8_t changes;
+  bool restarted = false; // Static modes repaint on the frame the scene restarts
+#if !DUAL_CORE_PIPELINE
+  int shownMode = myData.modeId;
+#endif
+  if (takeSettingsUpdate(myData, changes)) {
+    bool newScene = (changes & CHANGE_MODE) && sceneChanged(myOldData, myData);
+    // Only a change the running modes cannot follow restarts them; see sceneNeedsRedraw
+    bool redraw = (changes & CHANGE_MODE) ||
+                  ((changes & (CHANGE_COLORS | CHANGE_PARAMS | CHANGE_GEOMETRY)) && sceneNeedsRedraw(myOldData, myData));
+    restarted = redraw;
+    if (redraw) {
+      // Save the current stripData as stripDataOld, then recycle the previous old frame as the new stripData
+      StripData* recycled = stripDataOld;
+      stripDataOld = stripData;
+      stripData = recycled;
+      stripData->resize(myData.ledCount);
+      stripData->clear();
+      resetScene(stripData, stripDataOld, myData, newScene, nowUs);
+    } else {
+      // The modes carry on as if no update came and pick up the new values as they glide in.
+      // The frame is sent again in case only the output settings changed.
+      stripData->markAllDirty();
     }
+    // A restart jumps straight to the new values; otherwise glide from wherever the last one got to
+    beginSlew(redraw ? myData : myLiveData, nowUs);
 
-    Serial.println(F("Updating strip settings...")); 
-    strip.setBrightness(convertBrightness(myData.brightness));
-    strip.updateLength(myData.ledCount);
-    strip.updateType(myData.colorOrder);
-    strip.clear();
-    strip.show();  
-    if (String(myOldData.lightMode) != myData.lightMode) { 
-      transitionValue = 100; // Start transition
+    Serial.printf("Updating strip settings (changes 0x%02X)\n", changes);
+#if !DUAL_CORE_PIPELINE
+    // Close the outgoing mode's output counters before the new one adds to them
+    if (myData.modeId != shownMode) logOutputStats(shownMode);
+    // With the pipeline the output task applies these when the next frame arrives.
+    // A brightness change only marks the LUT stale; the next encode rebuilds it.
+    if (changes & CHANGE_BRIGHTNESS) output->setBrightness(convertBrightness(myData.brightness));
+    if (changes & CHANGE_OUTPUT) {
+      output->setGamma(myData.gamma);
+      output->setColorCorrection(myData.colorCorrection);
+      output->setDither(myData.dither);
+      output->setPowerLimit(myData.maxCurrent, myData.ledMilliamps, myData.idleMilliamps);
+      output->setKeepAlive(myData.keepAlive);
+    }
+    // Only new geometry reconfigures the chains, which blanks them
+    if (changes & CHANGE_GEOMETRY) {
+      OutputConfig layout[MAX_OUTPUTS];
+      output->begin(layout, outputLayout(myData, layout));
+      output->clear();
+      output->show();
+    }
+#endif
+    if (newScene) { 
+      transitionValue = 255; // Start transition
+      beginTransition(stripDataOld, myOldData, myData);
       Serial.print(F("Starting transition."));
     }
   } 
 
-  String currentMode = String(myData.lightMode);
-  // Only run passive effects when an update occurred; dynamic effects every loop
-  if (isStaticMode(currentMode)) {
-    if (myData.updated) {
-      callModeFunction(currentMode, stripData, &myData);
-    }
-  } else {
-    callModeFunction(currentMode, stripData, &myData);
-  }
+  // Static modes only repaint when an update occurred or a parameter moved; dynamic ones every loop
+  advanceSlew(myLiveData, myData, nowUs);
+  myLiveData.updated = restarted;
+  renderScene(stripData, myLiveData, nowUs);
+  envelope = sceneEnvelope(false);
 
-  if (transitionValue < 2) {
+  if (transitionValue < 5) {
     transitionValue = 0;
     show();
   } else {
-    transitionValue -= 2;
-    String oldEffect = String(myOldData.lightMode);
-    // Only advance old passive effect if it is dynamic (i.e., not passive)
-    if (!isStaticMode(oldEffect)) {
-      callModeFunction(oldEffect, stripDataOld, &myOldData);
-    }
+    transitionValue -= 5;
+    // The old scene advances on its own mode instances, so sharing a mode with the new one is safe.
+    // Its policy (frozen, decimated or full rate) was picked from the measured costs.
+    renderPreviousScene(stripDataOld, myOldData, nowUs);
+    // Crossfade the envelopes along with the frames
+    int oldEnvelope = sceneEnvelope(true);
+    envelope = oldEnvelope + (envelope - oldEnvelope) * (255 - transitionValue) / 255;
     blendAndShow();
   }
-
-  if (myData.updated) { 
-    myData.updated = false; // Reset update flag
-  }
 }
 
-uint32_t blendColors(uint32_t color1, uint32_t color2, int blend) {
-  // Extract RGB components
-  uint8_t r1 = (color1 >> 16) & 0xFF;
-  uint8_t g1 = (color1 >> 8) & 0xFF;
-  uint8_t b1 = color1 & 0xFF;
-  
-  uint8_t r2 = (color2 >> 16) & 0xFF;
-  uint8_t g2 = (color2 >> 8) & 0xFF;
-  uint8_t b2 = color2 & 0xFF;
-  
-  // Blend (blend 0-100, where 100 is fully color2)
-  uint8_t r = r1 + ((r2 - r1) * blend / 100);
-  uint8_t g = g1 + ((g2 - g1) * blend / 100);
-  uint8_t b = b1 + ((b2 - b1) * blend / 100);
-  
-  return strip.Color(r, g, b);
-}
+#if DUAL_CORE_PIPELINE
+// Hand the finished frame to the output task; the renderer never waits for the wire
+static uint8_t publishedEnvelope = 255;
 
 void show() {
-  for (int i = 0; i < strip.numPixels(); i++) {
-    strip.setPixelColor(i, stripData->getPixelColor(i));
-  }
-  strip.show();
+  // Nothing changed since the last published frame. Dithering needs a fresh encode every frame,
+  // and a new envelope a fresh table.
+  if (!stripData->isDirty() && !myData.dither && envelope == publishedEnvelope) return;
+  StripData* out = pipelineBackFrame();
+  out->resize(stripData->pixelCount);
+  memcpy(out->pixels, stripData->pixels, stripData->pixelCount * sizeof(uint32_t));
+  // The slots rotate, so the output task always re-encodes a published frame in full
+  out->markAllDirty();
+  stripData->clearDirty();
+  publishedEnvelope = envelope;
+  pipelinePublish(myData, envelope);
 }
 
 void blendAndShow() {
-  // Blend old and new strip data during transition
-  for (int i = 0; i < strip.numPixels(); i++) {
+  StripData* out = pipelineBackFrame();
+  out->resize(stripData->pixelCount);
+  uint8_t weight = 255 - transitionValue;
+  for (int i = 0; i < out->pixelCount; i++) {
     uint32_t oldColor = stripDataOld->getPixelColor(i);
-    uint32_t newColor = stripData->getPixelColor(i);
-    uint32_t blendedColor = blendColors(oldColor, newColor, 100 - transitionValue);
-    strip.setPixelColor(i, blendedColor);
+    uint32_t newColor = stripData->pixels[i];
+    out->pixels[i] = myData.linearBlend ? blendPixelsLinear(oldColor, newColor, weight) : blendPixels(oldColor, newColor, weight);
   }
-  strip.show();
+  out->markAllDirty();
+  // The last blended frame is not stripData, so the first show() after the transition must publish
+  stripData->markAllDirty();
+  publishedEnvelope = envelope;
+  pipelinePublish(myData, envelope);
+}
+#else
+void show() {
+  // Only the dirty span is re-encoded; an unchanged frame is only retransmitted as a keep-alive.
+  // A new envelope rebuilds the table and so re-encodes everything.
+  output->setEnvelope(envelope);
+  if (output->encode(stripData)) output->show();
+}
+
+void blendAndShow() {
+  // Blend old and new strip data during transition
+  output->setEnvelope(envelope);
+  if (output->encodeBlend(stripDataOld, stripData, 255 - transitionValue, myData.linearBlend)) output->show();
 }
+#endif
@@ -0,0 +1,73 @@
+#include "lighting.h"
+#include <Arduino.h>
+
+// Mode state lives in a fixed arena like the frame pool: the compositor acquires a slot for each
+// mode when a scene starts and releases it once that scene has finished transitioning out.
+static ModeInstance modeInstances[MAX_MODE_INSTANCES];
+static bool instanceInUse[MAX_MODE_INSTANCES];
+static uint8_t* scratchArena = nullptr;
+
+void initModeInstances() {
+  if (scratchArena) return;
+  scratchArena = new uint8_t[MODE_SCRATCH_ARENA_SIZE];
+  for (int i = 0; i < MAX_MODE_INSTANCES; i++) {
+    modeInstances[i].scratchBase = nullptr;
+    modeInstances[i].scratchSize = 0;
+    instanceInUse[i] = false;
+  }
+}
+
+// First fit over the other instances' claims. Only enter/resize ask for more, so this stays off
+// the per-frame path.
+bool ModeInstance::claimScratch(size_t bytes) {
+  scratchBase = nullptr;
+  scratchSize = 0;
+  bytes = (bytes + 3) & ~(size_t)3;
+  size_t start = 0;
+  for (int i = 0; i < MAX_MODE_INSTANCES; i++) {
+    const ModeInstance& other = modeInstances[i];
+    if (!other.scratchSize) continue;
+    size_t offset = other.scratchBase - scratchArena;
+    if (offset < start + bytes && start < offset + other.scratchSize) {
+      // Overlaps: try just past it, and check every claim again from there
+      start = offset + other.scratchSize;
+      i = -1;
+    }
+  }
+  if (start + bytes > (size_t)MODE_SCRATCH_ARENA_SIZE) {
+    Serial.println(F("Mode scratch arena exhausted"));
+    return false;
+  }
+  scratchBase = scratchArena + start;
+  scratchSize = bytes;
+  return true;
+}
+
+ModeInstance* acquireModeInstance(int modeId, uint32_t seed) {
+  for (int i = 0; i < MAX_MODE_INSTANCES; i++) {
+    if (!instanceInUse[i]) {
+      instanceInUse[i] = true;
+      modeInstances[i].modeId = modeId;
+      modeInstances[i].constructed = false;
+      modeInstances[i].entered = false;
+      modeInstances[i].pixelCount = 0;
+      modeInstances[i].scratchBase = nullptr;
+      modeInstances[i].scratchSize = 0;
+      modeInstances[i].frame = {0, 0, 0, seed ? seed : 1, 255};
+      return &modeInstances[i];
+    }
+  }
+  Serial.println(F("Mode instance arena exhausted"));
+  return nullptr;
+}
+
+void releaseModeInstance(ModeInstance* instance) {
+  if (!instance) return;
+  if (instance->entered && instance->modeId >= 0 && instance->modeId < modeCount) {
+    const ModeInfo& mode = modeTable[instance->modeId];
+    if (mode.exit) mode.exit(instance);
+  }
+  instance->scratchBase = nullptr;
+  instance->scratchSize = 0;
+  instanceInUse[instance - modeInstances] = false;
+}
@@ -8,28 +8,30 @@ static inline float smoothstep(float edge0, float edge1, float x) {
   return t * t * (3.0f - 2.0f * t);
 }
 
+struct AuroraState {
+  float p1 = 0;
+  float p2 = 0;
+  float p3 = 0;
+};
+
 // Aurora Mode
-void mode_aurora(StripData* data, const struct_message* config) {
+void mode_aurora(StripData* data, const struct_message* config, ModeInstance* instance, FrameContext& frame) {
   const struct_message* cfg = config ? config : &myData;
+  AuroraState& s = instance->get<AuroraState>();
 
-  static uint32_t lastMs = 0;
-  static float p1 = 0, p2 = 0, p3 = 0;
-
-  uint32_t now = millis();
-  uint32_t dt = now - lastMs;
-  lastMs = now;
-  if (dt > 100) dt = 100;
+  // Phase velocities are per ms; clamp long gaps so a stall does not jump the waves
+  float dt = min(frame.dtUs, (uint32_t)100000) / 1000.0f;
 
   float sp = map(cfg->speed, 1, 100, 5, 160) / 1000.0f;
-  p1 += dt * 14.0f * sp;
-  p2 += dt * 9.0f * sp;
-  p3 += dt * 5.0f * sp;
+  s.p1 += dt * 14.0f * sp;
+  s.p2 += dt * 9.0f * sp;
+  s.p3 += dt * 5.0f * sp;
 
-  if (p1 > 10000) p1 -= 10000;
-  if (p2 > 10000) p2 -= 10000;
-  if (p3 > 10000) p3 -= 10000;
+  if (s.p1 > 10000) s.p1 -= 10000;
+  if (s.p2 > 10000) s.p2 -= 10000;
+  if (s.p3 > 10000) s.p3 -= 10000;
 
-  float brightScale = constrain(cfg->intensity, 1U, 100U) / 100.0f;
+  float brightScale = constrain(cfg->intensity, 1, 100) / 100.0f;
 
   bool reverse = (cfg->direction == 1);
 
@@ -57,9 +59,9 @@ void mode_aurora(StripData* data, const struct_message* config) {
     if (reverse) n = 1.0f - n;
 
     // Layered sin "noise"
-    float a = sinf(n * 6.28318f * 1.2f + p1 * 0.010f);
-    float b = sinf(n * 6.28318f * 2.3f + p2 * 0.008f);
-    float c = sinf(n * 6.28318f * 3.7f + p3 * 0.006f);
+    float a = sinf(n * 6.28318f * 1.2f + s.p1 * 0.010f);
+    float b = sinf(n * 6.28318f * 2.3f + s.p2 * 0.008f);
+    float c = sinf(n * 6.28318f * 3.7f + s.p3 * 0.006f);
 
     float composite = (a * 0.55f) + (b * 0.30f) + (c * 0.15f);
     float t = (composite + 1.0f) * 0.5f;
@@ -69,7 +71,7 @@ void mode_aurora(StripData* data, const struct_message* config) {
     float purpleWeight = smoothstep(0.15f, 0.55f, n);
 
     // Brightness modulation ripple
-    float ripple = 0.55f + 0.45f * sinf(n * 6.28318f * 0.7f + p2 * 0.004f + sinf(p3 * 0.002f));
+    float ripple = 0.55f + 0.45f * sinf(n * 6.28318f * 0.7f + s.p2 * 0.004f + sinf(s.p3 * 0.002f));
     float localBrightness = (0.2f + 0.8f * t) * ripple;
 
     // Build green ribbon color
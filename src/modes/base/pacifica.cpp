@@ -2,23 +2,24 @@
 #include "communications.h"
 #include <Arduino.h>
 
+struct PacificaState {
+  // Wave phases for smooth animation
+  float phase1 = 0;
+  float phase2 = 0;
+  float phase3 = 0;
+  float phase4 = 0;
+};
+
 // Gentle layered ocean-style waves inspired by Adafruit's Pacifica.
 // Uses speed to control wave speed (higher = faster),
 // intensity to control overall brightness (1-100),
 // direction to optionally reverse wave travel (0 forward, 1 reverse),
 // colorOne (if non-zero) to tint highlights.
-void mode_pacifica(StripData* data, const struct_message* config) {
+void mode_pacifica(StripData* data, const struct_message* config, ModeInstance* instance, FrameContext& frame) {
   const struct_message* cfg = config ? config : &myData;
+  PacificaState& s = instance->get<PacificaState>();
 
-  // Static state for smooth animation
-  static uint32_t lastMillis = 0;
-  static float phase1 = 0, phase2 = 0, phase3 = 0, phase4 = 0;
-
-  uint32_t now = millis();
-  uint32_t delta = now - lastMillis;
-  lastMillis = now;
-
-  if (delta > 100) delta = 100; // clamp large gaps
+  float delta = min(frame.dtUs, (uint32_t)100000) / 1000.0f; // ms, clamp large gaps
 
   // Map speed (1-100) to phase increments (base speeds for each layer)
   float speedScale = map(cfg->speed, 1, 100, 5, 120) / 1000.0f; // overall multiplier
@@ -29,16 +30,16 @@ void mode_pacifica(StripData* data, const struct_message* config) {
   float inc4 =  2.5f * speedScale;
 
   // Advance phases (delta compensates for loop timing)
-  phase1 += inc1 * delta;
-  phase2 += inc2 * delta;
-  phase3 += inc3 * delta;
-  phase4 += inc4 * delta;
+  s.phase1 += inc1 * delta;
+  s.phase2 += inc2 * delta;
+  s.phase3 += inc3 * delta;
+  s.phase4 += inc4 * delta;
 
   // Keep phases bounded
-  if (phase1 > 10000) phase1 -= 10000;
-  if (phase2 > 10000) phase2 -= 10000;
-  if (phase3 > 10000) phase3 -= 10000;
-  if (phase4 > 10000) phase4 -= 10000;
+  if (s.phase1 > 10000) s.phase1 -= 10000;
+  if (s.phase2 > 10000) s.phase2 -= 10000;
+  if (s.phase3 > 10000) s.phase3 -= 10000;
+  if (s.phase4 > 10000) s.phase4 -= 10000;
 
   // Intensity controls brightness ceiling
   float brightnessScale = constrain(cfg->intensity, 1, 100) / 100.0f;
@@ -87,10 +88,10 @@ void mode_pacifica(StripData* data, const struct_message* config) {
     if (dir < 0) n = 1.0f - n;
 
     // Layered wave contributions
-    float w1 = sinf((n * 6.28318f * 1.0f) + phase1 * 0.010f);
-    float w2 = sinf((n * 6.28318f * 1.3f) + phase2 * 0.008f);
-    float w3 = sinf((n * 6.28318f * 2.0f) + phase3 * 0.006f);
-    float w4 = sinf((n * 6.28318f * 3.0f) + phase4 * 0.004f);
+    float w1 = sinf((n * 6.28318f * 1.0f) + s.phase1 * 0.010f);
+    float w2 = sinf((n * 6.28318f * 1.3f) + s.phase2 * 0.008f);
+    float w3 = sinf((n * 6.28318f * 2.0f) + s.phase3 * 0.006f);
+    float w4 = sinf((n * 6.28318f * 3.0f) + s.phase4 * 0.004f);
 
     // Weight layers
     float composite = (w1 * 0.45f) + (w2 * 0.30f) + (w3 * 0.18f) + (w4 * 0.07f);
@@ -98,7 +99,7 @@ void mode_pacifica(StripData* data, const struct_message* config) {
     float t = (composite + 1.0f) * 0.5f;
 
     // Slow drift through palette with phase4 slowest
-    float globalShift = fmodf((phase4 * 0.0002f), 1.0f);
+    float globalShift = fmodf((s.phase4 * 0.0002f), 1.0f);
     float lookup = fmodf(t * 0.7f + globalShift, 1.0f);
 
     uint32_t baseColor = paletteLookup(lookup);
@@ -2,12 +2,15 @@
 #include "communications.h"
 #include <Arduino.h>
 
+struct PaletteState {
+  StepClock     steps;
+  uint8_t       paletteIndex = 0;
+};
+
 // Palette mode - uses effect_static to create solid colors, cycling through palette
-void mode_palette(StripData* data, const struct_message* config) {
+void mode_palette(StripData* data, const struct_message* config, ModeInstance* instance, FrameContext& frame) {
   const struct_message* cfg = config ? config : &myData;
-  
-  static unsigned long lastUpdate = 0;
-  static uint8_t paletteIndex = 0;
+  PaletteState& s = instance->get<PaletteState>();
   
   // Define a color palette (can be expanded)
   static const uint32_t palette[] = {
@@ -26,20 +29,17 @@ void mode_palette(StripData* data, const struct_message* config) {
   };
   const int paletteSize = sizeof(palette) / sizeof(palette[0]);
   
-  unsigned long now = millis();
-  
   // Speed controls palette cycling speed
   uint32_t cycleInterval = map(cfg->speed, 1, 100, 1000, 50);
   
-  if (now - lastUpdate >= cycleInterval) {
-    lastUpdate = now;
-    
+  uint32_t due = s.steps.advance(frame.dtUs, cycleInterval * 1000);
+  for (uint32_t step = 0; step < due; step++) {
     // Cycle through palette
-    paletteIndex = (paletteIndex + 1) % paletteSize;
+    s.paletteIndex = (s.paletteIndex + 1) % paletteSize;
     
     // Use intensity to blend between palette colors
-    uint32_t currentColor = palette[paletteIndex];
-    uint32_t nextColor = palette[(paletteIndex + 1) % paletteSize];
+    uint32_t currentColor = palette[s.paletteIndex];
+    uint32_t nextColor = palette[(s.paletteIndex + 1) % paletteSize];
     
     // Simple blend based on intensity
     uint8_t blendAmount = map(cfg->intensity, 1, 100, 0, 255);
@@ -59,13 +59,6 @@ void mode_palette(StripData* data, const struct_message* config) {
     uint32_t blendedColor = strip.Color(r, g, b);
     
     // Use effect_static to fill all pixels with the current palette color
-    StripData* staticResult = effect_static(blendedColor);
-    
-    // Copy result to actual strip data
-    for (int i = 0; i < data->pixelCount; i++) {
-      data->setPixelColor(i, staticResult->getPixelColor(i));
-    }
-    
-    delete staticResult;
+    effect_static(data, blendedColor);
   }
 }
\ No newline at end of file
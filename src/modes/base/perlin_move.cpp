@@ -2,15 +2,18 @@
 #include "communications.h"
 #include <Arduino.h>
 
+struct PerlinMoveState {
+  StepClock     steps;
+  bool          initialized = false;
+};
+
 // Perlin noise movement mode - creates base pattern using effect_static, then shifts it
-void mode_perlin_move(StripData* data, const struct_message* config) {
+void mode_perlin_move(StripData* data, const struct_message* config, ModeInstance* instance, FrameContext& frame) {
   const struct_message* cfg = config ? config : &myData;
-  
-  static unsigned long lastUpdate = 0;
-  static bool initialized = false;
+  PerlinMoveState& s = instance->get<PerlinMoveState>();
   
   // Initialize with noise pattern if not done or on update
-  if (!initialized || cfg->updated) {
+  if (!s.initialized || cfg->updated) {
     // Create noise-based pattern
     for (int i = 0; i < data->pixelCount; i++) {
       // Use position-based noise for initial pattern
@@ -28,25 +31,15 @@ void mode_perlin_move(StripData* data, const struct_message* config) {
       
       data->setPixelColor(i, strip.Color(r, g, b));
     }
-    initialized = true;
+    s.initialized = true;
   }
   
-  unsigned long now = millis();
-  
   // Speed controls shift frequency
   uint32_t shiftInterval = map(cfg->speed, 1, 100, 500, 50);
   
-  if (now - lastUpdate >= shiftInterval) {
-    lastUpdate = now;
-    
-    // Use effect_shift to move the pattern
-    StripData* shiftResult = effect_shift(data, cfg->direction);
-    
-    // Copy shifted result back
-    for (int i = 0; i < data->pixelCount; i++) {
-      data->setPixelColor(i, shiftResult->getPixelColor(i));
-    }
-    
-    delete shiftResult;
+  // Use effect_shift to move the pattern, one pixel per elapsed interval
+  uint32_t due = s.steps.advance(frame.dtUs, shiftInterval * 1000);
+  for (uint32_t step = 0; step < due; step++) {
+    effect_shift(data, cfg->direction);
   }
 }
\ No newline at end of file
@@ -2,31 +2,31 @@
 #include "communications.h"
 #include <Arduino.h>
 
+struct PlasmaState {
+  StepClock steps;
+  float     time = 0.0f;
+};
+
 // Plasma mode - custom plasma effect (too complex for simple effects)
-void mode_plasma(StripData* data, const struct_message* config) {
+void mode_plasma(StripData* data, const struct_message* config, ModeInstance* instance, FrameContext& frame) {
   const struct_message* cfg = config ? config : &myData;
-  
-  static unsigned long lastUpdate = 0;
-  static float time = 0.0f;
-  
-  unsigned long now = millis();
+  PlasmaState& s = instance->get<PlasmaState>();
   
   // Speed controls animation rate
   uint32_t updateInterval = map(cfg->speed, 1, 100, 100, 10);
   
-  if (now - lastUpdate >= updateInterval) {
-    lastUpdate = now;
-    
-    // Advance time
-    time += 0.1f;
+  uint32_t due = s.steps.advance(frame.dtUs, updateInterval * 1000);
+  if (due > 0) {
+    // Advance time by every step that elapsed, then draw once
+    s.time += 0.1f * due;
     
     for (int i = 0; i < data->pixelCount; i++) {
       // Create plasma effect using multiple sine waves
       float x = (float)i / data->pixelCount;
       
-      float plasma = sin(x * 10.0f + time) + 
-                     sin(x * 15.0f + time * 1.2f) + 
-                     sin(x * 20.0f + time * 0.8f);
+      float plasma = sin(x * 10.0f + s.time) + 
+                     sin(x * 15.0f + s.time * 1.2f) + 
+                     sin(x * 20.0f + s.time * 0.8f);
       
       // Normalize plasma value to 0-1
       plasma = (plasma + 3.0f) / 6.0f;
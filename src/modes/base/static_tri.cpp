@@ -3,11 +3,8 @@
 #include <Arduino.h>
 
 // Static pattern - colorOne, colorTwo, colorThree
-void mode_static_tri(StripData* data, const struct_message* config) {
+void mode_static_tri(StripData* data, const struct_message* config, ModeInstance* instance, FrameContext& frame) {
   const struct_message* cfg = config ? config : &myData;
-  
-  // skip if not updated
-  if (!cfg->updated) return;
 
   // Create triangular pattern using three colors
   // Divide strip into three equal sections
@@ -2,6 +2,13 @@
 #include "communications.h"
 #include <Arduino.h>
 
+struct SunriseState {
+  uint64_t elapsedUs = 0;   // Progress through the current run, in time at the current speed
+  uint32_t durationMs = 0;  // Run length elapsedUs is measured against
+  bool     sunset = false;
+  bool     wasRunning = false;
+};
+
 // Sunrise Mode
 // speed meaning (minutes / behavior):
 //   0  -> static full sunrise
@@ -11,21 +18,9 @@
 // colorOne optional sun core color (default warm)
 // colorTwo optional sky high color
 // direction: 0 normal, 1 reverse strip direction (sun position mirrored)
-void mode_sunrise(StripData* data, const struct_message* config) {
+void mode_sunrise(StripData* data, const struct_message* config, ModeInstance* instance, FrameContext& frame) {
   const struct_message* cfg = config ? config : &myData;
-
-  static uint32_t phaseStart = 0;
-  static bool wasRunning = false;
-  static uint8_t lastSpeed = 0;
-
-  uint32_t now = millis();
-
-  // Reset animation when config updated or speed changed
-  if (cfg->updated || cfg->speed != lastSpeed) {
-    phaseStart = now;
-    lastSpeed = cfg->speed;
-    wasRunning = false;
-  }
+  SunriseState& s = instance->get<SunriseState>();
 
   int pc = data->pixelCount;
   if (pc <= 0) return;
@@ -45,16 +40,27 @@ void mode_sunrise(StripData* data, const struct_message* config) {
     }
   }
 
+  uint32_t durationMs = (uint32_t)minutes * 60000UL;
+
+  // Restart when config updated or switching between sunrise and sunset. A new speed keeps the
+  // progress made so far and carries on at the new rate, so a slider drag does not start over.
+  if (cfg->updated || sunset != s.sunset || s.durationMs == 0) {
+    s.elapsedUs = 0;
+    s.sunset = sunset;
+    s.wasRunning = false;
+  } else if (durationMs != s.durationMs) {
+    s.elapsedUs = s.elapsedUs * durationMs / s.durationMs;
+  }
+  s.durationMs = durationMs;
+
   float progress = 1.0f;
   if (!staticMode) {
-    uint32_t durationMs = (uint32_t)minutes * 60000UL;
-    if (durationMs == 0) durationMs = 1;
-    uint32_t elapsed = now - phaseStart;
-    if (elapsed >= durationMs) {
-      elapsed = durationMs;
-      wasRunning = true;
+    s.elapsedUs += frame.dtUs;
+    if (s.elapsedUs >= (uint64_t)durationMs * 1000) {
+      s.elapsedUs = (uint64_t)durationMs * 1000;
+      s.wasRunning = true;
     }
-    progress = (float)elapsed / (float)durationMs;
+    progress = (float)s.elapsedUs / ((float)durationMs * 1000.0f);
     if (sunset) {
       progress = 1.0f - progress; // invert for sunset
     }
@@ -136,7 +142,7 @@ void mode_sunrise(StripData* data, const struct_message* config) {
   // Static full sunrise mode (speed == 0): ensure full progress state
   if (staticMode) {
     // Just ensure brightness scaled by intensity (optional)
-    float scale = constrain(cfg->intensity, 1U, 100U) / 100.0f;
+    float scale = constrain(cfg->intensity, 1, 100) / 100.0f;
     if (scale < 0.999f) {
       for (int i = 0; i < pc; i++) {
         uint32_t c = data->getPixelColor(i);
@@ -2,20 +2,15 @@
 #include "communications.h"
 #include <Arduino.h>
 
+struct BlinkState {
+  BlinkCursor blink;
+};
+
 // blink between colorOne and black
-void mode_blink(StripData* data, const struct_message* config) {
-  const struct_message* cfg = config ? config : &myData; 
-  StripData* colorSource = createColoredStripData(data->pixelCount, cfg->colorOne);
+void mode_blink(StripData* data, const struct_message* config, ModeInstance* instance, FrameContext& frame) {
+  const struct_message* cfg = config ? config : &myData;
+  BlinkState& s = instance->get<BlinkState>();
   // Use speed to calculate blink interval
   uint32_t blinkInterval = map(cfg->speed, 1, 100, 1000, 100); // Slower speed = longer interval
-  StripData* blinkResult = effect_blink(colorSource, nullptr, blinkInterval);
-  
-  // Copy result to actual strip data
-  for (int i = 0; i < data->pixelCount; i++) {
-    data->setPixelColor(i, blinkResult->getPixelColor(i));
-  }
-  
-  // Clean up temporary data
-  delete colorSource;
-  delete blinkResult;
+  effect_blink(data, &s.blink, frame.dtUs, cfg->colorOne, 0x000000, blinkInterval);
 }
\ No newline at end of file
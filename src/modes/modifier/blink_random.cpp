@@ -2,40 +2,32 @@
 #include "communications.h"
 #include <Arduino.h>
 
+struct BlinkRandomState {
+  BlinkCursor   blink;
+  uint32_t      currentRandomColor = 0; // Picked on enter, then on every off -> on edge
+  unsigned long lastColorChange = 0;
+  bool          wasOn = false; // Track previous blink state
+};
+
+void blink_random_enter(StripData* data, const struct_message* config, ModeInstance* instance, FrameContext& frame) {
+  instance->get<BlinkRandomState>().currentRandomColor = randomColor(frame);
+}
+
 // blink random colors
-void mode_blink_random(StripData* data, const struct_message* config) {
+void mode_blink_random(StripData* data, const struct_message* config, ModeInstance* instance, FrameContext& frame) {
   const struct_message* cfg = config ? config : &myData;
-  static uint32_t currentRandomColor = randomColor(); // Generate once and store
-  static unsigned long lastColorChange = 0;
-  static bool wasOn = false; // Track previous blink state
+  BlinkRandomState& s = instance->get<BlinkRandomState>();
   
   // Use speed to calculate blink interval
   uint32_t blinkInterval = map(cfg->speed, 1, 100, 1000, 100); // Slower speed = longer interval
   
-  StripData* colorSource = createColoredStripData(data->pixelCount, currentRandomColor);
-  StripData* blinkResult = effect_blink(colorSource, nullptr, blinkInterval);
-  
-  // Check if light is currently on (non-zero color means on)
-  bool isOn = (blinkResult->getPixelColor(0) != 0);
+  bool isOn = effect_blink(data, &s.blink, frame.dtUs, s.currentRandomColor, 0x000000, blinkInterval);
   
   // Generate new color when transitioning from off to on
-  if (isOn && !wasOn) {
-    currentRandomColor = randomColor();
-    // Recreate the color source with the new color
-    delete colorSource;
-    colorSource = createColoredStripData(data->pixelCount, currentRandomColor);
-    delete blinkResult;
-    blinkResult = effect_blink(colorSource, nullptr, blinkInterval);
-  }
-  
-  wasOn = isOn;
-  
-  // Copy result to actual strip data
-  for (int i = 0; i < data->pixelCount; i++) {
-    data->setPixelColor(i, blinkResult->getPixelColor(i));
+  if (isOn && !s.wasOn) {
+    s.currentRandomColor = randomColor(frame);
+    effect_static(data, s.currentRandomColor);
   }
   
-  // Clean up temporary data
-  delete colorSource;
-  delete blinkResult;
+  s.wasOn = isOn;
 }
\ No newline at end of file
@@ -2,22 +2,15 @@
 #include "communications.h"
 #include <Arduino.h>
 
+struct BlinkToggleState {
+  BlinkCursor blink;
+};
+
 // Blink between colorOne and colorTwo
-void mode_blink_toggle(StripData* data, const struct_message* config) { 
+void mode_blink_toggle(StripData* data, const struct_message* config, ModeInstance* instance, FrameContext& frame) {
   const struct_message* cfg = config ? config : &myData;
-  StripData* colorSource = createColoredStripData(data->pixelCount, cfg->colorOne);
-  StripData* colorSourceTwo = createColoredStripData(data->pixelCount, cfg->colorTwo);
+  BlinkToggleState& s = instance->get<BlinkToggleState>();
   // Use speed to calculate blink interval
   uint32_t blinkInterval = map(cfg->speed, 1, 100, 1000, 100); // Slower speed = longer interval
-  StripData* blinkResult = effect_blink(colorSource, colorSourceTwo, blinkInterval);
-  
-  // Copy result to actual strip data
-  for (int i = 0; i < data->pixelCount; i++) {
-    data->setPixelColor(i, blinkResult->getPixelColor(i));
-  }
-  
-  // Clean up temporary data
-  delete colorSource;
-  delete colorSourceTwo;
-  delete blinkResult;
+  effect_blink(data, &s.blink, frame.dtUs, cfg->colorOne, cfg->colorTwo, blinkInterval);
 }
\ No newline at end of file
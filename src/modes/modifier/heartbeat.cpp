@@ -2,15 +2,21 @@
 #include "communications.h"
 #include <Arduino.h>
 
-// Heartbeat effect - pulsing rhythm using effect_fade
-void mode_heartbeat(StripData* data, const struct_message* config) {
+struct HeartbeatState {
+  StepClock steps;
+  uint32_t  beatElapsed = 0; // ms into the current beat cycle
+  int       fadeLevel = 0;
+};
+
+// Envelope between beats, percent. Stacked as a layer the envelope dims the whole composited
+// scene, so resting at zero would black out the modes beneath it too.
+static const int HEARTBEAT_REST_LEVEL = 20;
+
+// Heartbeat effect - pulsing rhythm. The pulse is the output envelope, so the pixels beneath
+// (inherited from the previous scene, or the layers it is stacked with) are never touched.
+void mode_heartbeat(StripData* data, const struct_message* config, ModeInstance* instance, FrameContext& frame) {
   const struct_message* cfg = config ? config : &myData;
-  
-  static unsigned long lastBeat = 0;
-  static unsigned long lastUpdate = 0;
-  static int fadeLevel = 0;
-  
-  unsigned long now = millis();
+  HeartbeatState& s = instance->get<HeartbeatState>();
   
   // Speed controls heartbeat rate (1-100 maps to slow-fast heart rate)
   uint32_t beatInterval = map(cfg->speed, 1, 100, 1200, 400); // Full heartbeat cycle
@@ -18,16 +24,12 @@ void mode_heartbeat(StripData* data, const struct_message* config) {
   // Update interval for smooth fading
   uint32_t updateInterval = 50;
   
-  if (now - lastUpdate >= updateInterval) {
-    lastUpdate = now;
-    
+  uint32_t due = s.steps.advance(frame.dtUs, updateInterval * 1000);
+  for (uint32_t step = 0; step < due; step++) {
     // Determine which phase of heartbeat we're in
-    uint32_t elapsed = now - lastBeat;
-    
-    if (elapsed >= beatInterval) {
-      lastBeat = now;
-      elapsed = 0;
-    }
+    uint32_t elapsed = s.beatElapsed;
+    s.beatElapsed += updateInterval;
+    if (s.beatElapsed >= beatInterval) s.beatElapsed = 0;
     
     // Calculate target fade level based on heartbeat phase
     int targetFade = 0;
@@ -48,22 +50,16 @@ void mode_heartbeat(StripData* data, const struct_message* config) {
     }
     
     // Smooth transition to target
-    if (fadeLevel < targetFade) {
-      fadeLevel += 5;
-      if (fadeLevel > targetFade) fadeLevel = targetFade;
-    } else if (fadeLevel > targetFade) {
-      fadeLevel -= 3;
-      if (fadeLevel < targetFade) fadeLevel = targetFade;
-    }
-    
-    // Apply fade effect to existing strip data
-    StripData* fadeResult = effect_fade(data, fadeLevel);
-    
-    // Copy result to actual strip data
-    for (int i = 0; i < data->pixelCount; i++) {
-      data->setPixelColor(i, fadeResult->getPixelColor(i));
+    if (s.fadeLevel < targetFade) {
+      s.fadeLevel += 5;
+      if (s.fadeLevel > targetFade) s.fadeLevel = targetFade;
+    } else if (s.fadeLevel > targetFade) {
+      s.fadeLevel -= 3;
+      if (s.fadeLevel < targetFade) s.fadeLevel = targetFade;
     }
-    
-    delete fadeResult;
   }
+
+  // Beats rise from the resting level instead of from black
+  int level = HEARTBEAT_REST_LEVEL + s.fadeLevel * (100 - HEARTBEAT_REST_LEVEL) / 100;
+  frame.envelope = level * 255 / 100;
 }
\ No newline at end of file
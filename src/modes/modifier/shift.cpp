@@ -2,27 +2,20 @@
 #include "communications.h"
 #include <Arduino.h>
 
+struct ShiftState {
+  StepClock steps;
+};
+
 // - SPECIAL - Shift mode - Inherits colors. continuously shifts existing pixel colors
-void mode_shift(StripData* data, const struct_message* config) {
+void mode_shift(StripData* data, const struct_message* config, ModeInstance* instance, FrameContext& frame) {
   const struct_message* cfg = config ? config : &myData;
-  static unsigned long lastUpdate = 0;
-  
-  unsigned long now = millis();
+  ShiftState& s = instance->get<ShiftState>();
   
   // Speed 100 = 50ms (fast), Speed 1 = 1000ms (slow)
   uint32_t shiftInterval = map(cfg->speed, 1, 100, 1000, 50);
   
-  if (now - lastUpdate >= shiftInterval) {
-    lastUpdate = now;
-    
-    StripData* shiftResult = effect_shift(data, cfg->direction);
-    
-    // Copy result to actual strip data
-    for (int i = 0; i < data->pixelCount; i++) {
-      data->setPixelColor(i, shiftResult->getPixelColor(i));
-    }
-    
-    // Clean up temporary data
-    delete shiftResult;
+  uint32_t due = s.steps.advance(frame.dtUs, shiftInterval * 1000);
+  for (uint32_t step = 0; step < due; step++) {
+    effect_shift(data, cfg->direction);
   }
 }
\ No newline at end of file
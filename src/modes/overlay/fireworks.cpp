@@ -2,81 +2,77 @@
 #include "communications.h"
 #include <Arduino.h>
 
+struct FireworksState {
+  StepClock     steps;
+  unsigned long lastLaunch = 0;
+  bool          rocketActive = false;
+  bool          exploding = false;
+  int           explosionFrame = 0;
+  int           explosionCenter = 0;
+  uint32_t      explosionColor = 0;
+  int           rocketPixel = 0;
+};
+
 // Fireworks effect - uses effect_swipe to create rocket, then custom explosion
-void mode_fireworks(StripData* data, const struct_message* config) {
+void mode_fireworks(StripData* data, const struct_message* config, ModeInstance* instance, FrameContext& frame) {
   const struct_message* cfg = config ? config : &myData;
+  FireworksState& s = instance->get<FireworksState>();
   
-  static unsigned long lastUpdate = 0;
-  static unsigned long lastLaunch = 0;
-  static bool rocketActive = false;
-  static bool exploding = false;
-  static int explosionFrame = 0;
-  static int explosionCenter = 0;
-  static uint32_t explosionColor = 0;
-  static int rocketPixel = 0;
-  
-  unsigned long now = millis();
+  unsigned long now = frame.nowMs;
   
   // Speed controls animation rate
   uint32_t updateInterval = map(cfg->speed, 1, 100, 100, 10);
   
-  if (now - lastUpdate >= updateInterval) {
-    lastUpdate = now;
-    
-    if (!rocketActive && !exploding) {
+  uint32_t due = s.steps.advance(frame.dtUs, updateInterval * 1000);
+  for (uint32_t step = 0; step < due; step++) {
+    if (!s.rocketActive && !s.exploding) {
       // Launch interval based on intensity
       uint32_t launchInterval = map(cfg->intensity, 1, 100, 3000, 500);
-      if (now - lastLaunch >= launchInterval) {
-        rocketActive = true;
-        rocketPixel = 0;
-        lastLaunch = now;
+      if (now - s.lastLaunch >= launchInterval) {
+        s.rocketActive = true;
+        s.rocketPixel = 0;
+        s.lastLaunch = now;
       }
     }
     
-    if (rocketActive) {
+    if (s.rocketActive) {
       // Use effect_swipe to create rocket trail
       uint32_t rocketColor = (cfg->colorOne != 0) ? cfg->colorOne : 0xFFFFFF;
-      StripData* swipeResult = effect_swipe(data, cfg->direction, rocketColor, &rocketPixel);
-      
-      // Copy swipe result
-      for (int i = 0; i < data->pixelCount; i++) {
-        data->setPixelColor(i, swipeResult->getPixelColor(i));
-      }
-      delete swipeResult;
+      effect_swipe(data, nullptr, cfg->direction, rocketColor, &s.rocketPixel);
       
-      rocketPixel++;
-      if (rocketPixel >= data->pixelCount * 0.7f) {
+      s.rocketPixel++;
+      if (s.rocketPixel >= data->pixelCount * 0.7f) {
         // Start explosion
-        rocketActive = false;
-        exploding = true;
-        explosionFrame = 0;
-        explosionCenter = rocketPixel;
-        explosionColor = randomColor();
+        s.rocketActive = false;
+        s.exploding = true;
+        s.explosionFrame = 0;
+        s.explosionCenter = s.rocketPixel;
+        s.explosionColor = randomColor(frame);
       }
     }
     
-    if (exploding) {
+    if (s.exploding) {
       // Clear strip first
       for (int i = 0; i < data->pixelCount; i++) {
         data->setPixelColor(i, 0);
       }
       
       // Draw explosion manually (too complex for simple effects)
-      int radius = explosionFrame / 2;
-      for (int i = max(0, explosionCenter - radius); 
-           i <= min(data->pixelCount - 1, explosionCenter + radius); i++) {
-        uint8_t brightness = 255 - (explosionFrame * 15);
+      int radius = s.explosionFrame / 2;
+      for (int i = max(0, s.explosionCenter - radius); 
+           i <= min(data->pixelCount - 1, s.explosionCenter + radius); i++) {
+        uint8_t brightness = 255 - (s.explosionFrame * 15);
         if (brightness > 0) {
-          uint8_t r = ((explosionColor >> 16) & 0xFF) * brightness / 255;
-          uint8_t g = ((explosionColor >> 8) & 0xFF) * brightness / 255;
-          uint8_t b = (explosionColor & 0xFF) * brightness / 255;
+          uint8_t r = ((s.explosionColor >> 16) & 0xFF) * brightness / 255;
+          uint8_t g = ((s.explosionColor >> 8) & 0xFF) * brightness / 255;
+          uint8_t b = (s.explosionColor & 0xFF) * brightness / 255;
           data->setPixelColor(i, strip.Color(r, g, b));
         }
       }
       
-      explosionFrame++;
-      if (explosionFrame > 15) {
-        exploding = false;
+      s.explosionFrame++;
+      if (s.explosionFrame > 15) {
+        s.exploding = false;
       }
     }
   }
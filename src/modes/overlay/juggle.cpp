@@ -2,57 +2,47 @@
 #include "communications.h"
 #include <Arduino.h>
 
+struct JuggleState {
+  StepClock     steps;
+  int           dotPositions[8] = {};
+  uint32_t      dotColors[8] = {};
+  bool          initialized = false;
+};
+
 // Juggle effect - uses effect_fade for trails and effect_swipe for dots
-void mode_juggle(StripData* data, const struct_message* config) {
+void mode_juggle(StripData* data, const struct_message* config, ModeInstance* instance, FrameContext& frame) {
   const struct_message* cfg = config ? config : &myData;
+  JuggleState& s = instance->get<JuggleState>();
   
-  static unsigned long lastUpdate = 0;
-  static int dotPositions[8];
-  static uint32_t dotColors[8];
-  static bool initialized = false;
-  
-  if (!initialized || cfg->updated) {
+  if (!s.initialized || cfg->updated) {
     // Initialize dot positions and colors
     for (int i = 0; i < 8; i++) {
-      dotPositions[i] = i * data->pixelCount / 8;
-      dotColors[i] = randomColor();
+      s.dotPositions[i] = i * data->pixelCount / 8;
+      s.dotColors[i] = randomColor(frame);
     }
-    initialized = true;
+    s.initialized = true;
   }
   
-  unsigned long now = millis();
-  
   // Speed controls animation rate
   uint32_t updateInterval = map(cfg->speed, 1, 100, 100, 10);
   
-  if (now - lastUpdate >= updateInterval) {
-    lastUpdate = now;
-    
+  uint32_t due = s.steps.advance(frame.dtUs, updateInterval * 1000);
+  for (uint32_t step = 0; step < due; step++) {
     // Apply fade effect first for trails
-    StripData* fadeResult = effect_fade(data, 92); // 92% fade for smooth trails
-    
-    // Copy faded result back
-    for (int i = 0; i < data->pixelCount; i++) {
-      data->setPixelColor(i, fadeResult->getPixelColor(i));
-    }
-    delete fadeResult;
+    effect_fade(data, 92); // 92% fade for smooth trails
     
     // Update and draw dots using effect_swipe
     int dotCount = map(cfg->intensity, 1, 100, 3, 8);
     for (int i = 0; i < dotCount; i++) {
       // Move dot
-      dotPositions[i] += 1 + (i * 1); // Different speeds for each dot
-      if (dotPositions[i] >= data->pixelCount) {
-        dotPositions[i] = 0;
-        dotColors[i] = randomColor();
+      s.dotPositions[i] += 1 + (i * 1); // Different speeds for each dot
+      if (s.dotPositions[i] >= data->pixelCount) {
+        s.dotPositions[i] = 0;
+        s.dotColors[i] = randomColor(frame);
       }
       
       // Draw dot using swipe effect
-      StripData* dotResult = effect_swipe(data, 0, dotColors[i], &dotPositions[i]);
-      
-      // Copy only the new dot pixel
-      data->setPixelColor(dotPositions[i], dotResult->getPixelColor(dotPositions[i]));
-      delete dotResult;
+      effect_swipe(data, nullptr, 0, s.dotColors[i], &s.dotPositions[i]);
     }
   }
 }
\ No newline at end of file
@@ -2,41 +2,35 @@
 #include "communications.h"
 #include <Arduino.h>
 
+struct MeteorState {
+  StepClock     steps;
+  int           meteorPos = 0;
+  uint32_t      meteorColor = 0;
+};
+
 // Meteor trail effect - uses effect_fade for trails and effect_swipe for meteor head
-void mode_meteor(StripData* data, const struct_message* config) {
+void mode_meteor(StripData* data, const struct_message* config, ModeInstance* instance, FrameContext& frame) {
   const struct_message* cfg = config ? config : &myData;
-  
-  static unsigned long lastUpdate = 0;
-  static int meteorPos = 0;
-  static uint32_t meteorColor = 0;
-  
-  unsigned long now = millis();
+  MeteorState& s = instance->get<MeteorState>();
   
   // Speed controls meteor movement
   uint32_t meteorInterval = map(cfg->speed, 1, 100, 150, 15);
   
-  if (now - lastUpdate >= meteorInterval) {
-    lastUpdate = now;
-    
+  uint32_t due = s.steps.advance(frame.dtUs, meteorInterval * 1000);
+  for (uint32_t step = 0; step < due; step++) {
     // Initialize or reset meteor
-    if (meteorPos >= data->pixelCount || cfg->updated) {
-      meteorPos = 0;
-      meteorColor = (cfg->colorOne != 0) ? cfg->colorOne : randomColor();
+    if (s.meteorPos >= data->pixelCount || cfg->updated) {
+      s.meteorPos = 0;
+      s.meteorColor = (cfg->colorOne != 0) ? cfg->colorOne : randomColor(frame);
     }
     
     // Apply fade effect for existing pixels (meteor trail)
     int fadeIntensity = map(cfg->intensity, 1, 100, 50, 90); // Trail length control
-    StripData* fadeResult = effect_fade(data, fadeIntensity);
-    
-    // Copy faded result back
-    for (int i = 0; i < data->pixelCount; i++) {
-      data->setPixelColor(i, fadeResult->getPixelColor(i));
-    }
-    delete fadeResult;
+    effect_fade(data, fadeIntensity);
     
     // Draw meteor head using direct pixel setting (brighter than trail)
-    data->setPixelColor(meteorPos, meteorColor);
+    data->setPixelColor(s.meteorPos, s.meteorColor);
     
-    meteorPos++;
+    s.meteorPos++;
   }
 }
\ No newline at end of file
@@ -2,27 +2,31 @@
 #include "communications.h"
 #include <Arduino.h>
 
+// One pixel per step, the pace the swipe ran at under its 50ms frame period
+constexpr uint32_t SWIPE_STEP_MS = 50;
+
+struct SwipeState {
+  SwipeCursor cursor;
+  StepClock   steps;
+  int         pixelsFilled = 0;
+  bool        usecolorOne = true;
+};
+
 // Swipe effect that alternates between colorOne and colorTwo
-void mode_swipe(StripData* data, const struct_message* config) { 
+void mode_swipe(StripData* data, const struct_message* config, ModeInstance* instance, FrameContext& frame) {
   const struct_message* cfg = config ? config : &myData;
-  static int pixelsFilled = 0;
-  static bool usecolorOne = true;
-  
-  // Default behavior: alternate between colorOne and colorTwo
-  uint32_t color = usecolorOne ? cfg->colorOne : cfg->colorTwo;
-  StripData* swipeResult = effect_swipe(data, cfg->direction, color);
-  
-  // Copy result to actual strip data
-  for (int i = 0; i < data->pixelCount; i++) {
-    data->setPixelColor(i, swipeResult->getPixelColor(i));
-  }
-  
-  // Clean up temporary data
-  delete swipeResult;
+  SwipeState& s = instance->get<SwipeState>();
   
-  // Track when we've filled all pixels
-  if (++pixelsFilled >= data->pixelCount) { 
-    usecolorOne = !usecolorOne; 
-    pixelsFilled = 0; 
+  uint32_t due = s.steps.advance(frame.dtUs, SWIPE_STEP_MS * 1000);
+  for (uint32_t step = 0; step < due; step++) {
+    // Default behavior: alternate between colorOne and colorTwo
+    uint32_t color = s.usecolorOne ? cfg->colorOne : cfg->colorTwo;
+    effect_swipe(data, &s.cursor, cfg->direction, color);
+    
+    // Track when we've filled all pixels
+    if (++s.pixelsFilled >= data->pixelCount) { 
+      s.usecolorOne = !s.usecolorOne; 
+      s.pixelsFilled = 0; 
+    }
   }
 }
\ No newline at end of file
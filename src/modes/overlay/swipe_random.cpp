@@ -2,24 +2,32 @@
 #include "communications.h"
 #include <Arduino.h>
 
+// One pixel per step, the pace the swipe ran at under its 50ms frame period
+constexpr uint32_t SWIPE_RANDOM_STEP_MS = 50;
+
+struct SwipeRandomState {
+  SwipeCursor cursor;
+  StepClock   steps;
+  uint32_t    randColor = 0; // Picked on enter and after every full pass
+  int         randPixelsFilled = 0;
+};
+
+void swipe_random_enter(StripData* data, const struct_message* config, ModeInstance* instance, FrameContext& frame) {
+  instance->get<SwipeRandomState>().randColor = randomColor(frame);
+}
+
 // Swipe effect with random colors
-void mode_swipe_random(StripData* data, const struct_message* config) { 
+void mode_swipe_random(StripData* data, const struct_message* config, ModeInstance* instance, FrameContext& frame) {
   const struct_message* cfg = config ? config : &myData;
-  static uint32_t randColor = randomColor();
-  static int randPixelsFilled = 0;
-  
-  StripData* swipeResult = effect_swipe(data, cfg->direction, randColor);
-  
-  // Copy result to actual strip data
-  for (int i = 0; i < data->pixelCount; i++) {
-    data->setPixelColor(i, swipeResult->getPixelColor(i));
-  }
-  
-  // Clean up temporary data
-  delete swipeResult;
+  SwipeRandomState& s = instance->get<SwipeRandomState>();
   
-  if (++randPixelsFilled >= data->pixelCount) {
-    randColor = randomColor();
-    randPixelsFilled = 0;
+  uint32_t due = s.steps.advance(frame.dtUs, SWIPE_RANDOM_STEP_MS * 1000);
+  for (uint32_t step = 0; step < due; step++) {
+    effect_swipe(data, &s.cursor, cfg->direction, s.randColor);
+    
+    if (++s.randPixelsFilled >= data->pixelCount) {
+      s.randColor = randomColor(frame);
+      s.randPixelsFilled = 0;
+    }
   }
 }
\ No newline at end of file
@@ -2,61 +2,65 @@
 #include "communications.h"
 #include <Arduino.h>
 
+struct TetrixState {
+  StepClock     steps;
+  int           blockPosition = 0;
+  uint32_t      blockColor = 0;
+  bool          blockActive = false;
+  int           stackHeight = 0;
+};
+
+// Empty the stack kept in the instance scratch (enter, resize and settings updates)
+void tetrix_reset(StripData* data, const struct_message* config, ModeInstance* instance, FrameContext& frame) {
+  TetrixState& s = instance->get<TetrixState>();
+  bool* stackPixels = instance->scratch<bool>(data->pixelCount);
+  if (!stackPixels) return;
+  for (int i = 0; i < data->pixelCount; i++) {
+    stackPixels[i] = false;
+  }
+  s.stackHeight = 0;
+}
+
 // Tetrix effect - uses effect_static for blocks and custom stacking logic
-void mode_tetrix(StripData* data, const struct_message* config) {
+void mode_tetrix(StripData* data, const struct_message* config, ModeInstance* instance, FrameContext& frame) {
   const struct_message* cfg = config ? config : &myData;
+  TetrixState& s = instance->get<TetrixState>();
   
-  static unsigned long lastUpdate = 0;
-  static int blockPosition = 0;
-  static uint32_t blockColor = 0;
-  static bool blockActive = false;
-  static bool* stackPixels = nullptr;
-  static int stackHeight = 0;
-  
-  // Initialize stack if needed
-  if (stackPixels == nullptr || cfg->updated) {
-    if (stackPixels) delete[] stackPixels;
-    stackPixels = new bool[data->pixelCount];
-    for (int i = 0; i < data->pixelCount; i++) {
-      stackPixels[i] = false;
-    }
-    stackHeight = 0;
-  }
-  
-  unsigned long now = millis();
+  bool* stackPixels = instance->scratch<bool>(data->pixelCount);
+  if (!stackPixels) return;
+  if (cfg->updated) tetrix_reset(data, cfg, instance, frame);
   
   // Speed controls fall rate
   uint32_t fallInterval = map(cfg->speed, 1, 100, 300, 30);
   
-  if (now - lastUpdate >= fallInterval) {
-    lastUpdate = now;
-    
-    if (!blockActive) {
+  uint32_t due = s.steps.advance(frame.dtUs, fallInterval * 1000);
+  for (uint32_t step = 0; step < due; step++) {
+    if (!s.blockActive) {
       // Spawn new block
-      blockPosition = data->pixelCount - 1;
-      blockColor = (cfg->colorOne != 0) ? cfg->colorOne : randomColor();
-      blockActive = true;
+      s.blockPosition = data->pixelCount - 1;
+      s.blockColor = (cfg->colorOne != 0) ? cfg->colorOne : randomColor(frame);
+      s.blockActive = true;
     } else {
       // Move block down
-      blockPosition--;
+      s.blockPosition--;
       
       // Check if block hits stack or bottom
-      if (blockPosition <= stackHeight || blockPosition < 0) {
+      if (s.blockPosition <= s.stackHeight || s.blockPosition < 0) {
         // Block lands
-        int landPos = max(0, blockPosition + 1);
+        int landPos = max(0, s.blockPosition + 1);
         if (landPos < data->pixelCount && !stackPixels[landPos]) {
           stackPixels[landPos] = true;
-          stackHeight = max(stackHeight, landPos + 1);
+          s.stackHeight = max(s.stackHeight, landPos + 1);
         }
-        blockActive = false;
+        s.blockActive = false;
         
         // Check for game over (stack reaches top)
-        if (stackHeight >= data->pixelCount * 0.9f) {
+        if (s.stackHeight >= data->pixelCount * 0.9f) {
           // Reset stack
           for (int i = 0; i < data->pixelCount; i++) {
             stackPixels[i] = false;
           }
-          stackHeight = 0;
+          s.stackHeight = 0;
         }
       }
     }
@@ -68,15 +72,15 @@ void mode_tetrix(StripData* data, const struct_message* config) {
     
     // Draw stack using effect_static for each stack pixel
     uint32_t stackColor = (cfg->colorTwo != 0) ? cfg->colorTwo : 0x404040;
-    for (int i = 0; i < stackHeight; i++) {
+    for (int i = 0; i < s.stackHeight; i++) {
       if (stackPixels[i]) {
         data->setPixelColor(i, stackColor);
       }
     }
     
     // Draw falling block
-    if (blockActive && blockPosition >= 0 && blockPosition < data->pixelCount) {
-      data->setPixelColor(blockPosition, blockColor);
+    if (s.blockActive && s.blockPosition >= 0 && s.blockPosition < data->pixelCount) {
+      data->setPixelColor(s.blockPosition, s.blockColor);
     }
   }
 }
\ No newline at end of file
@@ -0,0 +1,341 @@
+#include "output.h"
+#include <Adafruit_NeoPixel.h>
+
+OutputDriver* output = nullptr;
+
+// Position-dependent hash of one wire pixel; the frame fingerprint is the sum over all pixels
+static inline uint32_t pixelHash(int i, const uint8_t* wire) {
+  uint32_t h = ((wire[0] | (wire[1] << 8) | (wire[2] << 16)) ^ (i * 0x9E3779B1u)) * 0x85EBCA6Bu;
+  return h ^ (h >> 15);
+}
+
+bool OutputDriver::needsShow() {
+  if (!shownValid || frameHash != shownHash) return true;
+  if (keepAliveDue()) {
+    stats.keepAlives++;
+    return true;
+  }
+  stats.framesSuppressed++;
+  return false;
+}
+
+void OutputDriver::rebuildLut() {
+  if (curveStale) {
+    float exponent = gamma / 10.0f;
+    for (int ch = 0; ch < 3; ch++) {
+      uint8_t correction = (colorCorrection >> (16 - ch * 8)) & 0xFF;
+      for (int v = 0; v < 256; v++) {
+        float x = v / 255.0f;
+        if (gamma != 10) x = powf(x, exponent);
+        curve[ch][v] = (uint16_t)(x * correction * 256.0f + 0.5f);
+      }
+    }
+    curveStale = false;
+    // Brightness, envelope and limiter changes keep the residue: it is under one wire step either way
+    clearResidue();
+  }
+
+  // Brightness, the envelope and the limiter change far more often than the curve, so this part
+  // is integer only
+  uint32_t level = (((brightness * (envelope + 1)) >> 8) * (limit + 1)) >> 8;
+  for (int ch = 0; ch < 3; ch++) {
+    for (int v = 0; v < 256; v++) {
+      lut[ch][v] = (curve[ch][v] * level + 0x7F) / 0xFF;
+    }
+  }
+  lutStale = false;
+  fullRefresh = true;
+}
+
+// Runs after every encode. The estimate comes from channelSum, which the encode loops keep
+// current, so the limiter never walks the frame itself. A new limit takes effect on the next frame.
+void OutputDriver::updatePowerLimit() {
+  uint32_t idle = totalPixels * quiescentMilliamps;
+  // Draw of the encoded frame and what it would be without the limiter, both in mA * 255
+  uint64_t driven = (uint64_t)channelSum * channelMilliamps;
+  uint64_t unlimited = driven * 255 / max(limit, (uint8_t)1);
+  estimate = idle + driven / 255;
+  if (estimate > stats.peakMilliamps) stats.peakMilliamps = estimate;
+
+  uint8_t target = 255;
+  if (powerBudget > 0) {
+    uint64_t budget = powerBudget > (int)idle ? (uint64_t)(powerBudget - idle) * 255 : 0;
+    if (unlimited > budget) target = budget * 255 / unlimited;
+  }
+  if (target < 255) stats.framesLimited++;
+  // Back off immediately, recover with a little hysteresis so the table isn't rebuilt every frame
+  if (target < limit || target > limit + 4 || (target == 255 && limit != 255)) {
+    if (target != limit) lutStale = true;
+    limit = target;
+  }
+}
+
+// Fractional residue per pixel and source channel, carried between dithered frames
+static uint8_t residue[MAX_LED_COUNT * 3];
+
+void OutputDriver::clearResidue() {
+  memset(residue, 0, sizeof(residue));
+}
+
+inline void OutputDriver::mapPixel(uint8_t* wire, const Port& port, int i, uint32_t c) {
+  uint16_t r = lut[0][(c >> 16) & 0xFF];
+  uint16_t g = lut[1][(c >> 8) & 0xFF];
+  uint16_t b = lut[2][c & 0xFF];
+  if (dither) {
+    // Add last frame's leftover before truncating and keep the new leftover; r/g/b top out at
+    // 0xFF00, so the sum never overflows
+    uint8_t* res = residue + i * 3;
+    r += res[0];
+    g += res[1];
+    b += res[2];
+    res[0] = r;
+    res[1] = g;
+    res[2] = b;
+  } else {
+    r += 0x80;
+    g += 0x80;
+    b += 0x80;
+  }
+  wire[port.rOffset] = r >> 8;
+  wire[port.gOffset] = g >> 8;
+  wire[port.bOffset] = b >> 8;
+}
+
+bool OutputDriver::encode(StripData* frame) {
+  if (lutStale) rebuildLut();
+  int count = numPixels();
+  int start, end;
+  bool rehash = fullRefresh || !hashValid || dither;
+  if (rehash) {
+    start = 0;
+    end = count - 1;
+    frameHash = 0;
+    channelSum = 0;
+  } else if (frame->isDirty() && frame->dirtyStart < count) {
+    start = frame->dirtyStart;
+    end = min(frame->dirtyEnd, count - 1);
+  } else {
+    frame->clearDirty();
+    return needsShow();
+  }
+
+  int n = frame->pixelCount;
+  const uint32_t* src = frame->pixels;
+  uint32_t hash = frameHash;
+  uint32_t sum = channelSum;
+
+  for (int p = 0; p < portCount; p++) {
+    const Port& port = ports[p];
+    int lo = max(start, port.start);
+    int hi = min(end, port.start + port.count - 1);
+    if (lo > hi) continue;
+
+    uint8_t* wire = pixelBuffer(p) + (lo - port.start) * 3;
+    for (int i = lo; i <= hi; i++, wire += 3) {
+      if (!rehash) {
+        hash -= pixelHash(i, wire);
+        sum -= wire[0] + wire[1] + wire[2];
+      }
+      uint32_t c = i < n ? src[i] : 0;
+      mapPixel(wire, port, i, c);
+      hash += pixelHash(i, wire);
+      sum += wire[0] + wire[1] + wire[2];
+    }
+    bufferWritten(p);
+  }
+
+  frameHash = hash;
+  channelSum = sum;
+  hashValid = true;
+  frame->clearDirty();
+  fullRefresh = false;
+  stats.bytesEncoded += (end + 1 - start) * 3;
+  updatePowerLimit();
+  return needsShow();
+}
+
+bool OutputDriver::encodeBlend(const StripData* from, const StripData* to, uint8_t weight, bool linear) {
+  if (lutStale) rebuildLut();
+  int n = min(numPixels(), to->pixelCount);
+  int nFrom = min(n, from->pixelCount);
+  uint32_t hash = 0;
+  uint32_t sum = 0;
+
+  for (int p = 0; p < portCount; p++) {
+    const Port& port = ports[p];
+    uint8_t* wire = pixelBuffer(p);
+    int last = port.start + port.count;
+    for (int i = port.start; i < last; i++, wire += 3) {
+      uint32_t c = 0;
+      if (i < n) {
+        uint32_t a = i < nFrom ? from->pixels[i] : 0;
+        c = linear ? blendPixelsLinear(a, to->pixels[i], weight) : blendPixels(a, to->pixels[i], weight);
+      }
+      mapPixel(wire, port, i, c);
+      hash += pixelHash(i, wire);
+      sum += wire[0] + wire[1] + wire[2];
+    }
+    bufferWritten(p);
+  }
+
+  frameHash = hash;
+  channelSum = sum;
+  hashValid = true;
+  // The wire now holds a mix of two frames, so the next plain encode must rewrite all of it
+  fullRefresh = true;
+  stats.bytesEncoded += numPixels() * 3;
+  updatePowerLimit();
+  return needsShow();
+}
+
+void OutputDriver::begin(const OutputConfig* layout, int count) {
+  int start = 0;
+  bool moved = count != portCount;
+  for (int p = 0; p < count; p++) {
+    uint16_t order = layout[p].colorOrder;
+    if (p < portCount && (ports[p].start != start || ports[p].count != layout[p].pixelCount)) moved = true;
+    ports[p].start = start;
+    ports[p].count = layout[p].pixelCount;
+    ports[p].rOffset = (order >> 4) & 0x03;
+    ports[p].gOffset = (order >> 2) & 0x03;
+    ports[p].bOffset = order & 0x03;
+    configurePort(p, layout[p].pixelPin, layout[p].pixelCount, order);
+    start += layout[p].pixelCount;
+  }
+  for (int p = count; p < portCount; p++) {
+    releasePort(p);
+  }
+  portCount = count;
+  totalPixels = start;
+  if (moved) clearResidue();
+  fullRefresh = true;
+  hashValid = false;
+}
+
+int outputLayout(const struct_message& data, OutputConfig* layout) {
+  if (data.outputCount == 0) {
+    layout[0].pixelPin = data.pixelPin;
+    layout[0].pixelCount = data.pixelCount;
+    layout[0].colorOrder = data.colorOrder;
+    return 1;
+  }
+  memcpy(layout, data.outputs, data.outputCount * sizeof(OutputConfig));
+  return data.outputCount;
+}
+
+OutputStats OutputDriver::collectStats() {
+  OutputStats window = stats;
+  stats = {0, 0, 0, 0, 0, 0};
+  return window;
+}
+
+#if OUTPUT_DRIVER_ADAFRUIT
+
+// Fallback: Adafruit_NeoPixel bit-bangs each chain and blocks for its whole wire time,
+// so multiple chains are sent one after another
+class AdafruitOutput : public OutputDriver {
+  Adafruit_NeoPixel* chains[MAX_OUTPUTS] = {};
+
+ public:
+  bool busy() override { return false; }
+
+ protected:
+  void configurePort(int port, int pin, int pixelCount, uint16_t colorOrder) override {
+    Adafruit_NeoPixel*& chain = chains[port];
+    if (!chain) {
+      chain = new Adafruit_NeoPixel(pixelCount, pin, colorOrder);
+      chain->begin();
+      return;
+    }
+    chain->updateType(colorOrder);
+    if (chain->numPixels() != pixelCount) chain->updateLength(pixelCount);
+    if (chain->getPin() != pin) chain->setPin(pin);
+  }
+
+  void releasePort(int port) override {
+    delete chains[port];
+    chains[port] = nullptr;
+  }
+
+  void clearBuffer() override {
+    for (int p = 0; p < portCount; p++) chains[p]->clear();
+  }
+  void transmit() override {
+    for (int p = 0; p < portCount; p++) chains[p]->show();
+  }
+  // Adafruit's own brightness stays at full so it never rescales the buffer we write
+  uint8_t* pixelBuffer(int port) override { return chains[port]->getPixels(); }
+};
+
+OutputDriver* createOutputDriver() {
+  return new AdafruitOutput();
+}
+
+#else
+#include <NeoPixelBus.h>
+
+// RMT backend: NeoPixelBus keeps an edit buffer and a send buffer, so Show() hands the frame to the
+// RMT peripheral and returns while it is clocked out. Each chain is bound to its own RMT channel, so
+// show() starts every chain back to back and they transmit in parallel. Color order is applied
+// here, so the bus is RGB.
+typedef NeoPixelBus<NeoRgbFeature, NeoEsp32RmtNWs2812xMethod> RmtBus;
+
+class RmtOutput : public OutputDriver {
+  struct Chain {
+    RmtBus* bus;
+    int pin;
+    int count;
+  };
+  Chain chains[MAX_OUTPUTS] = {};
+
+ public:
+  bool busy() override {
+    for (int p = 0; p < portCount; p++) {
+      if (chains[p].bus && !chains[p].bus->CanShow()) return true;
+    }
+    return false;
+  }
+
+ protected:
+  void configurePort(int port, int pin, int pixelCount, uint16_t colorOrder) override {
+    Chain& chain = chains[port];
+    if (chain.bus && chain.pin == pin && chain.count == pixelCount) return;
+    if (chain.bus) {
+      waitDone();
+      delete chain.bus;
+    }
+    chain.pin = pin;
+    chain.count = pixelCount;
+    chain.bus = new RmtBus(pixelCount, pin, (NeoBusChannel)port);
+    chain.bus->Begin();
+  }
+
+  void releasePort(int port) override {
+    Chain& chain = chains[port];
+    if (!chain.bus) return;
+    waitDone();
+    delete chain.bus;
+    chain.bus = nullptr;
+  }
+
+  void clearBuffer() override {
+    for (int p = 0; p < portCount; p++) chains[p].bus->ClearTo(RgbColor(0, 0, 0));
+  }
+  // Show() returns early unless the bus is dirty, so mark it here: keep-alives resend an unchanged
+  // frame, and a suppressed frame never reaches transmit() at all
+  void transmit() override {
+    for (int p = 0; p < portCount; p++) {
+      chains[p].bus->Dirty();
+      chains[p].bus->Show();
+    }
+  }
+  // The edit buffer; Show() copies it to the RMT send buffer
+  uint8_t* pixelBuffer(int port) override { return chains[port].bus->Pixels(); }
+  void bufferWritten(int port) override { chains[port].bus->Dirty(); }
+};
+
+OutputDriver* createOutputDriver() {
+  return new RmtOutput();
+}
+
+#endif
@@ -0,0 +1,194 @@
+#ifndef OUTPUT_H
+#define OUTPUT_H
+
+#include <Arduino.h>
+#include "lighting.h"
+
+// LED output driver selection. The default RMT backend (NeoPixelBus) transmits asynchronously:
+// show() queues the frame and returns, busy() reports whether it is still on the wire. Each
+// physical chain gets its own RMT channel, so splitting a long strip across pins divides the wire time.
+// Build with -DOUTPUT_DRIVER_ADAFRUIT=1 to fall back to the blocking Adafruit_NeoPixel driver.
+#ifndef OUTPUT_DRIVER_ADAFRUIT
+#define OUTPUT_DRIVER_ADAFRUIT 0
+#endif
+
+// Output stage counters for the current telemetry window
+struct OutputStats {
+  uint32_t framesShown;      // Frames handed to the wire (including keep-alives)
+  uint32_t framesSuppressed; // Frames not retransmitted: nothing dirty, or byte-identical to the shown frame
+  uint32_t keepAlives;       // Unchanged frames retransmitted because the keep-alive interval ran out
+  uint32_t bytesEncoded;     // Wire bytes re-encoded
+  uint32_t peakMilliamps;    // Highest estimated strip draw
+  uint32_t framesLimited;    // Frames where the current limiter held brightness down
+};
+
+class OutputDriver {
+ public:
+  virtual ~OutputDriver() {}
+
+  // (Re)configure the physical chains. Each chain is fed the next consecutive range of the
+  // logical frame. Only reallocates a chain when its pin or length change.
+  void begin(const OutputConfig* layout, int count);
+  void clear() {
+    clearBuffer();
+    fullRefresh = true;
+    hashValid = false;
+  }
+  // Total pixels across all chains
+  int numPixels() { return totalPixels; }
+  int numOutputs() { return portCount; }
+
+  // Start transmitting the current pixels on every chain. Asynchronous backends return
+  // immediately, so the chains are clocked out concurrently.
+  void show() {
+    transmit();
+    shownHash = frameHash;
+    shownValid = hashValid;
+    lastShowMs = millis();
+    stats.framesShown++;
+  }
+  // True while a previous show() is still being transmitted on any chain
+  virtual bool busy() = 0;
+
+  void waitDone() {
+    while (busy()) { vTaskDelay(1); }
+  }
+
+  // Output curve. Brightness, gamma and white balance are folded into one 256-entry table per
+  // channel, rebuilt on the next encode after any of them changes.
+  void setBrightness(uint8_t value) {
+    if (value != brightness) lutStale = true;
+    brightness = value;
+  }
+  // Per-frame multiplier from the modifier modes (heartbeat, breath). Folded into the table like
+  // brightness, so modulating the whole strip costs a table rebuild instead of touching the frame.
+  void setEnvelope(uint8_t value) {
+    if (value != envelope) lutStale = true;
+    envelope = value;
+  }
+  // Gamma x10; 10 passes values straight through
+  void setGamma(int value) {
+    if (value != gamma) curveStale = lutStale = true;
+    gamma = value;
+  }
+  // 0xRRGGBB per-channel scale; 0xFFFFFF leaves colors untouched
+  void setColorCorrection(uint32_t value) {
+    if (value != colorCorrection) curveStale = lutStale = true;
+    colorCorrection = value;
+  }
+
+  // Temporal dithering: each pixel keeps the fractional part the 8-bit wire dropped and carries it
+  // into the next frame, so low brightness fades average out to the in-between levels. Dithered
+  // frames are re-encoded in full every time.
+  void setDither(bool enabled) {
+    if (enabled != dither) fullRefresh = true;
+    // Leftovers from an earlier dithered run would land on the first frame as a color step
+    if (enabled && !dither) clearResidue();
+    dither = enabled;
+  }
+
+  // Current limiter: brightness is pulled down so the estimated draw stays under maxMilliamps
+  // (0 = unlimited). Each LED draws ledMilliamps per channel at full output plus idleMilliamps.
+  void setPowerLimit(int maxMilliamps, int ledMilliamps, int idleMilliamps) {
+    powerBudget = maxMilliamps;
+    channelMilliamps = ledMilliamps;
+    quiescentMilliamps = idleMilliamps;
+  }
+  // Estimated draw of the last encoded frame, mA
+  uint32_t estimatedMilliamps() { return estimate; }
+  // Brightness multiplier applied by the limiter (255 = not limiting)
+  uint8_t powerLimit() { return limit; }
+
+  // Idle strips are refreshed every keepAliveMs even when nothing changed (0 = never)
+  void setKeepAlive(uint32_t ms) { keepAliveMs = ms; }
+  bool keepAliveDue() { return keepAliveMs && millis() - lastShowMs >= keepAliveMs; }
+  // Resend the shown frame when the keep-alive interval ran out without a new frame being encoded.
+  // Returns true when it did.
+  bool refresh() {
+    if (!keepAliveDue()) return false;
+    stats.keepAlives++;
+    show();
+    return true;
+  }
+
+  // Final output stage: write color-ordered bytes mapped through the output curve straight into the
+  // drivers' transmit buffers. Only the frame's dirty span is re-encoded, and a running
+  // fingerprint of the wire bytes is updated as it goes. Returns false when the wire ends
+  // up identical to the last shown frame (and no keep-alive is due), so show() can be skipped.
+  bool encode(StripData* frame);
+  // Same, crossfading from -> to (weight 0-255, where 255 is fully 'to'). Always re-encodes everything.
+  bool encodeBlend(const StripData* from, const StripData* to, uint8_t weight, bool linear);
+
+  // Close the current telemetry window
+  OutputStats collectStats();
+
+ protected:
+  // One physical chain: its range of the logical frame and the byte position of each
+  // channel on its wire, decoded from the Adafruit color order
+  struct Port {
+    int start;
+    int count;
+    uint8_t rOffset, gOffset, bOffset;
+  };
+  Port ports[MAX_OUTPUTS];
+  int portCount = 0;
+  int totalPixels = 0;
+
+  uint8_t brightness = 255;
+  uint8_t envelope = 255;
+  int gamma = 10;
+  uint32_t colorCorrection = 0xFFFFFF;
+  bool curveStale = true;
+  bool lutStale = true;
+  uint16_t curve[3][256]; // Gamma and white balance in 8.8 fixed point; only rebuilt when those change
+  uint16_t lut[3][256];   // curve scaled by brightness, envelope and the limiter (8.8), indexed by source channel value
+  void rebuildLut();
+
+  bool dither = false;
+  // Map one source color through the LUT into a pixel's wire bytes, dithering when enabled
+  inline void mapPixel(uint8_t* wire, const Port& port, int i, uint32_t c);
+  // Forget the carried fractions, when they no longer belong to the same pixels or curve
+  void clearResidue();
+
+  // Sum of all wire bytes, kept up to date alongside frameHash
+  uint32_t channelSum = 0;
+  int powerBudget = 0;
+  int channelMilliamps = 20;
+  int quiescentMilliamps = 1;
+  uint32_t estimate = 0;
+  uint8_t limit = 255;
+  void updatePowerLimit();
+
+  bool fullRefresh = true; // Wire buffer no longer matches any frame's clean pixels
+  OutputStats stats = {0, 0, 0, 0, 0, 0};
+
+  // Sum of per-pixel hashes of the wire buffer, so a dirty span can be swapped out without rehashing the rest
+  uint32_t frameHash = 0;
+  bool hashValid = false;  // frameHash describes the wire buffer
+  uint32_t shownHash = 0;
+  bool shownValid = false; // shownHash describes what is on the strip
+  uint32_t lastShowMs = 0;
+  uint32_t keepAliveMs = 0;
+
+  // Decide whether an encoded frame is worth sending
+  bool needsShow();
+
+  virtual void configurePort(int port, int pin, int pixelCount, uint16_t colorOrder) = 0;
+  // Free a chain dropped from the layout
+  virtual void releasePort(int port) = 0;
+  virtual void clearBuffer() = 0;
+  virtual void transmit() = 0;
+  // 3 bytes per pixel in wire order
+  virtual uint8_t* pixelBuffer(int port) = 0;
+  // Called after the buffer was written directly
+  virtual void bufferWritten(int port) {}
+};
+
+// Physical chains described by the settings: outputs[] when given, else the single pixelPin strip
+int outputLayout(const struct_message& data, OutputConfig* layout);
+
+OutputDriver* createOutputDriver();
+
+extern OutputDriver* output;
+
+#endif
@@ -0,0 +1,133 @@
+#include "pipeline.h"
+#include "output.h"
+
+#if DUAL_CORE_PIPELINE
+#include <assert.h>
+#include <atomic>
+
+// Triple buffer: the renderer owns backIndex, the output task owns frontIndex and the third
+// slot sits in 'middle'. Publishing and taking are single atomic exchanges, so neither side
+// ever blocks the other. FRESH marks a middle slot the output task has not shown yet.
+static const uint32_t FRESH = 0x4;
+static const uint32_t INDEX_MASK = 0x3;
+
+struct PipelineSlot {
+  StripData* frame;
+  int brightness;
+  uint8_t envelope;
+  int gamma;
+  uint32_t colorCorrection;
+  bool dither;
+  int maxCurrent;
+  int ledMilliamps;
+  int idleMilliamps;
+  OutputConfig layout[MAX_OUTPUTS];
+  int outputCount;
+  int keepAlive;
+};
+
+static PipelineSlot slots[3];
+static std::atomic<uint32_t> middle(1);
+static uint32_t backIndex = 0;
+static uint32_t frontIndex = 2;
+
+static TaskHandle_t outputTask = nullptr;
+static PipelineStats stats = {0, 0};
+
+static bool sameLayout(const OutputConfig* a, const OutputConfig* b, int count) {
+  for (int i = 0; i < count; i++) {
+    if (a[i].pixelPin != b[i].pixelPin || a[i].pixelCount != b[i].pixelCount || a[i].colorOrder != b[i].colorOrder) return false;
+  }
+  return true;
+}
+
+static void outputLoop(void*) {
+  OutputConfig shownLayout[MAX_OUTPUTS];
+  int shownOutputs = 0;
+  int keepAlive = 0;
+
+  for (;;) {
+    // The renderer stops publishing while the frame is unchanged; wake anyway for keep-alives
+    TickType_t timeout = keepAlive ? pdMS_TO_TICKS(keepAlive) : portMAX_DELAY;
+    ulTaskNotifyTake(pdTRUE, timeout);
+    if (!(middle.load() & FRESH)) {
+      if (output->refresh()) stats.framesShown++;
+      continue;
+    }
+    frontIndex = middle.exchange(frontIndex) & INDEX_MASK;
+
+    PipelineSlot& slot = slots[frontIndex];
+    StripData* frame = slot.frame;
+
+    // Geometry and the output curve are applied here so only this task touches the output driver
+    if (slot.outputCount != shownOutputs || !sameLayout(slot.layout, shownLayout, shownOutputs)) {
+      output->begin(slot.layout, slot.outputCount);
+      memcpy(shownLayout, slot.layout, sizeof(shownLayout));
+      shownOutputs = slot.outputCount;
+    }
+    // The setters only mark the output curve stale when a value actually changes
+    output->setBrightness(convertBrightness(slot.brightness));
+    output->setEnvelope(slot.envelope);
+    output->setGamma(slot.gamma);
+    output->setColorCorrection(slot.colorCorrection);
+    output->setDither(slot.dither);
+    output->setPowerLimit(slot.maxCurrent, slot.ledMilliamps, slot.idleMilliamps);
+    if (slot.keepAlive != keepAlive) {
+      output->setKeepAlive(slot.keepAlive);
+      keepAlive = slot.keepAlive;
+    }
+
+    if (output->encode(frame)) {
+      output->show();
+      stats.framesShown++;
+    }
+  }
+}
+
+void initPipeline() {
+  for (int i = 0; i < 3; i++) {
+    slots[i].frame = acquireFrame(0);
+    assert(slots[i].frame);
+    slots[i].brightness = 0;
+    slots[i].envelope = 255;
+    slots[i].gamma = 10;
+    slots[i].colorCorrection = 0xFFFFFF;
+    slots[i].dither = false;
+    slots[i].maxCurrent = 0;
+    slots[i].ledMilliamps = 20;
+    slots[i].idleMilliamps = 1;
+    slots[i].outputCount = 0;
+    slots[i].keepAlive = 0;
+  }
+  // The Arduino loop renders on its own core; push pixels from the other one
+  int outputCore = xPortGetCoreID() ^ 1;
+  xTaskCreatePinnedToCore(outputLoop, "ledOutput", 4096, nullptr, 2, &outputTask, outputCore);
+}
+
+StripData* pipelineBackFrame() {
+  return slots[backIndex].frame;
+}
+
+void pipelinePublish(const struct_message& settings, uint8_t envelope) {
+  slots[backIndex].brightness = settings.brightness;
+  slots[backIndex].envelope = envelope;
+  slots[backIndex].gamma = settings.gamma;
+  slots[backIndex].colorCorrection = settings.colorCorrection;
+  slots[backIndex].dither = settings.dither;
+  slots[backIndex].maxCurrent = settings.maxCurrent;
+  slots[backIndex].ledMilliamps = settings.ledMilliamps;
+  slots[backIndex].idleMilliamps = settings.idleMilliamps;
+  slots[backIndex].outputCount = outputLayout(settings, slots[backIndex].layout);
+  slots[backIndex].keepAlive = settings.keepAlive;
+
+  uint32_t previous = middle.exchange(backIndex | FRESH);
+  if (previous & FRESH) stats.framesDropped++;
+  backIndex = previous & INDEX_MASK;
+
+  xTaskNotifyGive(outputTask);
+}
+
+const PipelineStats& getPipelineStats() {
+  return stats;
+}
+#endif
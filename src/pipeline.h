@@ -0,0 +1,26 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include "lighting.h"
+
+// Opt-in dual-core render/output pipeline (build with -DDUAL_CORE_PIPELINE=1).
+// The Arduino loop renders frame N+1 while an output task pinned to the other core pushes frame N.
+// Frames are exchanged through a lock-free triple buffer of frame pool buffers.
+
+struct PipelineStats {
+  uint32_t framesShown;   // Frames pushed to the strip by the output task (including keep-alives)
+  uint32_t framesDropped; // Frames overwritten by the renderer before the output task took them
+};
+
+#if DUAL_CORE_PIPELINE
+void initPipeline();
+
+// Renderer side: fill the back frame, then publish it with the settings and modifier envelope it
+// should be shown with
+StripData* pipelineBackFrame();
+void pipelinePublish(const struct_message& settings, uint8_t envelope);
+
+const PipelineStats& getPipelineStats();
+#endif
+
+#endif
@@ -0,0 +1,59 @@
+#include "scheduler.h"
+#include <esp_timer.h>
+
+// Deadline-based frame scheduler.
+// The render loop sleeps in vTaskDelayUntil until the next frame is due, so the core is free
+// between frames and frames start on a fixed grid instead of whenever a millis() poll notices.
+
+static TickType_t lastWake = 0;
+static int64_t lastFrameUs = 0;
+static int64_t windowStartUs = 0;
+
+static uint32_t windowFrames = 0;
+static uint64_t windowJitterSumUs = 0;
+static uint32_t windowMaxJitterUs = 0;
+
+static FrameStats stats = {0, 0.0f, 0, 0};
+
+void waitForNextFrame(uint16_t periodMs) {
+  TickType_t period = pdMS_TO_TICKS(periodMs);
+  if (period == 0) period = 1;
+
+  TickType_t now = xTaskGetTickCount();
+  if (lastWake == 0 || (TickType_t)(now - lastWake) >= period) {
+    // Running late (or first frame): start a new grid instead of bursting to catch up
+    lastWake = now;
+  } else {
+    vTaskDelayUntil(&lastWake, period);
+  }
+
+  // Record the achieved frame interval
+  int64_t frameUs = esp_timer_get_time();
+  if (lastFrameUs != 0) {
+    int64_t interval = frameUs - lastFrameUs;
+    int64_t error = interval - (int64_t)periodMs * 1000;
+    uint32_t jitter = (uint32_t)(error < 0 ? -error : error);
+    windowJitterSumUs += jitter;
+    if (jitter > windowMaxJitterUs) windowMaxJitterUs = jitter;
+  } else {
+    windowStartUs = frameUs;
+  }
+  lastFrameUs = frameUs;
+  windowFrames++;
+}
+
+const FrameStats& collectFrameStats() {
+  int64_t now = esp_timer_get_time();
+  int64_t elapsed = now - windowStartUs;
+
+  stats.frames = windowFrames;
+  stats.fps = (elapsed > 0) ? windowFrames * 1000000.0f / elapsed : 0.0f;
+  stats.meanJitterUs = windowFrames > 0 ? windowJitterSumUs / windowFrames : 0;
+  stats.maxJitterUs = windowMaxJitterUs;
+
+  windowStartUs = now;
+  windowFrames = 0;
+  windowJitterSumUs = 0;
+  windowMaxJitterUs = 0;
+  return stats;
+}
@@ -0,0 +1,20 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <Arduino.h>
+
+// Frame timing measured over the current reporting window
+struct FrameStats {
+  uint32_t frames;        // Frames rendered in the window
+  float fps;              // Achieved frames per second over the last completed window
+  uint32_t meanJitterUs;  // Mean |actual - target| frame interval over the last window
+  uint32_t maxJitterUs;   // Worst |actual - target| frame interval over the last window
+};
+
+// Sleep until the next frame deadline. periodMs is the target frame period of the active mode(s).
+void waitForNextFrame(uint16_t periodMs);
+
+// Close the current reporting window and return its stats
+const FrameStats& collectFrameStats();
+
+#endif
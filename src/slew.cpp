@@ -0,0 +1,42 @@
+#include "slew.h"
+#include "lighting.h"
+
+static struct_message slewFrom;
+static int64_t slewStartUs = 0;
+
+void beginSlew(const struct_message& live, int64_t nowUs) {
+  cloneData(live, slewFrom);
+  slewStartUs = nowUs;
+}
+
+static inline int slewValue(int from, int to, uint8_t weight) {
+  return from + (to - from) * weight / 255;
+}
+
+bool advanceSlew(struct_message& live, const struct_message& target, int64_t nowUs) {
+  int speed = target.speed;
+  int intensity = target.intensity;
+  uint32_t colorOne = target.colorOne;
+  uint32_t colorTwo = target.colorTwo;
+  uint32_t colorThree = target.colorThree;
+
+  int64_t elapsedUs = nowUs - slewStartUs;
+  int64_t slewUs = (int64_t)target.slewMs * 1000;
+  bool gliding = elapsedUs < slewUs;
+  if (gliding) {
+    uint8_t weight = elapsedUs * 255 / slewUs;
+    speed = slewValue(slewFrom.speed, speed, weight);
+    intensity = slewValue(slewFrom.intensity, intensity, weight);
+    colorOne = blendPixels(slewFrom.colorOne, colorOne, weight);
+    colorTwo = blendPixels(slewFrom.colorTwo, colorTwo, weight);
+    colorThree = blendPixels(slewFrom.colorThree, colorThree, weight);
+  }
+
+  cloneData(target, live);
+  live.speed = speed;
+  live.intensity = intensity;
+  live.colorOne = colorOne;
+  live.colorTwo = colorTwo;
+  live.colorThree = colorThree;
+  return gliding;
+}
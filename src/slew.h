@@ -0,0 +1,20 @@
+#ifndef SLEW_H
+#define SLEW_H
+
+#include "communications.h"
+
+// Parameter slewing. Dragging a slider in the app sends a settings update per input event.
+// Instead of restarting the modes for each one, the continuous parameters (speed, intensity and
+// the three colors) glide from where they are toward the newest values over slewMs, and the
+// running modes pick them up as they go. Every other field follows the target at once.
+// Segments are not slewed: their parameters live in SegmentConfig, and a change to one a segment
+// reads restarts the scene, so segments jump to the new values.
+
+// Start a glide from live's current values. A glide still under way is retargeted from its
+// current position, so a stream of updates moves smoothly.
+void beginSlew(const struct_message& live, int64_t nowUs);
+
+// Move live toward target for the frame at nowUs. Returns true while the glide is under way.
+bool advanceSlew(struct_message& live, const struct_message& target, int64_t nowUs);
+
+#endif
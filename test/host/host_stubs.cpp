@@ -0,0 +1,134 @@
+#include "host_test.h"
+#include <esp_timer.h>
+#include <NeoPixelBus.h>
+#include <stdarg.h>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+int64_t hostNowUs = 1000000;
+uint32_t hostWireFrames = 0;
+HostBus hostBuses[HOST_MAX_BUSES] = {};
+void (*hostMicrosHook)() = nullptr;
+HardwareSerial Serial;
+EspClass ESP;
+
+unsigned long millis() { return (unsigned long)(hostNowUs / 1000); }
+unsigned long micros() {
+  if (hostMicrosHook) hostMicrosHook();
+  return (unsigned long)hostNowUs;
+}
+void delay(unsigned long ms) { hostAdvanceUs((int64_t)ms * 1000); }
+
+long map(long x, long inMin, long inMax, long outMin, long outMax) {
+  if (inMax == inMin) return outMin;
+  return (x - inMin) * (outMax - outMin) / (inMax - inMin) + outMin;
+}
+
+// xorshift32, so runs are repeatable
+uint32_t esp_random() {
+  static uint32_t state = 0x12345678;
+  state ^= state << 13;
+  state ^= state >> 17;
+  state ^= state << 5;
+  return state;
+}
+
+int HardwareSerial::printf(const char* format, ...) {
+  static bool verbose = getenv("HOST_VERBOSE") != nullptr;
+  if (!verbose) return 0;
+  va_list args;
+  va_start(args, format);
+  int n = vprintf(format, args);
+  va_end(args);
+  return n;
+}
+
+void String::trim() {
+  size_t first = value.find_first_not_of(" \t\r\n");
+  size_t last = value.find_last_not_of(" \t\r\n");
+  value = first == std::string::npos ? std::string() : value.substr(first, last - first + 1);
+}
+
+void String::toUpperCase() {
+  for (char& c : value) c = toupper(c);
+}
+
+TickType_t xTaskGetTickCount() { return (TickType_t)millis(); }
+void vTaskDelay(TickType_t ticks) { delay(ticks); }
+void vTaskDelayUntil(TickType_t* previousWake, TickType_t period) {
+  *previousWake += period;
+  int64_t wakeUs = (int64_t)*previousWake * 1000;
+  if (wakeUs > hostNowUs) hostNowUs = wakeUs;
+}
+
+// A task is a detached thread plus its notification count. Tasks never end, so neither is freed.
+struct HostTask {
+  std::mutex lock;
+  std::condition_variable notified;
+  uint32_t notifications = 0;
+};
+static thread_local HostTask* currentTask = nullptr;
+
+int xTaskCreatePinnedToCore(void (*code)(void*), const char*, int, void* parameter, int, TaskHandle_t* handle, int) {
+  HostTask* task = new HostTask();
+  if (handle) *handle = task;
+  std::thread([=] {
+    currentTask = task;
+    code(parameter);
+  }).detach();
+  return pdTRUE;
+}
+
+uint32_t ulTaskNotifyTake(int clearOnExit, TickType_t timeout) {
+  HostTask* task = currentTask;
+  if (!task) return 0;
+  std::unique_lock<std::mutex> hold(task->lock);
+  auto pending = [task] { return task->notifications > 0; };
+  if (timeout == portMAX_DELAY) task->notified.wait(hold, pending);
+  else task->notified.wait_for(hold, std::chrono::milliseconds(timeout), pending);
+  uint32_t count = task->notifications;
+  if (count) task->notifications = clearOnExit ? 0 : count - 1;
+  return count;
+}
+
+void xTaskNotifyGive(TaskHandle_t handle) {
+  HostTask* task = (HostTask*)handle;
+  if (!task) return;
+  std::lock_guard<std::mutex> hold(task->lock);
+  task->notifications++;
+  task->notified.notify_one();
+}
+
+// Counting allocator. Every block carries its size in front so frees can be subtracted from the
+// live total that ESP.getFreeHeap() reports.
+HeapCounters hostHeap = {0, 0, 0, 0};
+
+static const size_t HEADER = alignof(std::max_align_t);
+
+static void* countedAlloc(size_t size) {
+  char* block = (char*)malloc(size + HEADER);
+  if (!block) throw std::bad_alloc();
+  *(size_t*)block = size;
+  hostHeap.allocations++;
+  hostHeap.liveBytes += size;
+  if (hostHeap.liveBytes > hostHeap.peakBytes) hostHeap.peakBytes = hostHeap.liveBytes;
+  return block + HEADER;
+}
+
+static void countedFree(void* ptr) {
+  if (!ptr) return;
+  char* block = (char*)ptr - HEADER;
+  hostHeap.frees++;
+  hostHeap.liveBytes -= *(size_t*)block;
+  free(block);
+}
+
+void* operator new(size_t size) { return countedAlloc(size); }
+void* operator new[](size_t size) { return countedAlloc(size); }
+void operator delete(void* ptr) noexcept { countedFree(ptr); }
+void operator delete[](void* ptr) noexcept { countedFree(ptr); }
+void operator delete(void* ptr, size_t) noexcept { countedFree(ptr); }
+void operator delete[](void* ptr, size_t) noexcept { countedFree(ptr); }
+
+uint32_t EspClass::getFreeHeap() { return HOST_HEAP_BYTES - (uint32_t)hostHeap.liveBytes; }
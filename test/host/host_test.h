@@ -0,0 +1,63 @@
+#ifndef HOST_TEST_H
+#define HOST_TEST_H
+
+// Host test harness: a test registry, checks, and the counters behind the stubbed heap and clock.
+#include <Arduino.h>
+#include <new>
+#include <cstddef>
+
+constexpr uint32_t HOST_HEAP_BYTES = 320 * 1024; // ESP32 DRAM available to the heap
+
+// Updated by the global operator new/delete in host_stubs.cpp
+struct HeapCounters {
+  uint32_t allocations;
+  uint32_t frees;
+  size_t liveBytes;
+  size_t peakBytes;
+};
+extern HeapCounters hostHeap;
+
+typedef void (*TestFunction)();
+struct TestCase {
+  TestCase(const char* name, TestFunction run);
+  const char* name;
+  TestFunction run;
+  TestCase* next;
+};
+
+#define TEST(name)                                  \
+  static void name();                               \
+  static TestCase name##Case(#name, name);          \
+  static void name()
+
+#define CHECK(condition)                                                   \
+  do {                                                                     \
+    if (!(condition)) testFailed(__FILE__, __LINE__, #condition);          \
+  } while (0)
+
+void testFailed(const char* file, int line, const char* what);
+
+// Results and benchmark figures; always printed, unlike Serial
+void report(const char* format, ...) __attribute__((format(printf, 1, 2)));
+
+// Process CPU time, for benchmarks
+int64_t cpuTimeNs();
+
+// CPU time per call of run, averaged over iterations
+template <typename Run>
+int64_t benchmarkNs(int iterations, Run run) {
+  int64_t start = cpuTimeNs();
+  for (int i = 0; i < iterations; i++) run(i);
+  return (cpuTimeNs() - start) / iterations;
+}
+
+// Run the firmware's setup() once; every test after the first shares the booted state
+void bootFirmware();
+
+// Hand a JSON settings update to the parser, as a BLE write would
+void sendSettings(const char* json);
+
+// One pass of the firmware loop body at the given frame period
+void runFrame(uint32_t periodUs);
+
+#endif
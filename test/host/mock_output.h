@@ -0,0 +1,88 @@
+#ifndef MOCK_OUTPUT_H
+#define MOCK_OUTPUT_H
+
+#include "host_test.h"
+#include "output.h"
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+// Wall clock, for waits that stand in for the wire
+inline int64_t wallTimeNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+inline void sleepUntilNs(int64_t ns) {
+  int64_t left = ns - wallTimeNs();
+  if (left > 0) std::this_thread::sleep_for(std::chrono::nanoseconds(left));
+}
+
+// OutputDriver over plain arrays: the firmware's output stage without a bus behind it. Each chain
+// is a buffer of wire bytes. transmit() returns at once like the RMT backend, or with
+// blockingNsPerPixel set spins for the wire time like the bit-banged Adafruit one. With
+// wireNsPerPixel set the wire is timed on the wall clock and its waits sleep, so a host with one
+// CPU can still run the pipeline's output task alongside the renderer as if on its own core.
+class MockOutput : public OutputDriver {
+ public:
+  struct Chain {
+    int pin;
+    int count;
+    uint16_t colorOrder;
+    uint8_t bytes[MAX_LED_COUNT * 3];
+  };
+  Chain chains[MAX_OUTPUTS] = {};
+  std::atomic<uint32_t> transmits{0};
+  uint32_t blockingNsPerPixel = 0;
+  // A frame waits for the previous one to leave the wire; wireBlocks also holds the caller until
+  // its own frame is out, like a bit-banged driver
+  uint32_t wireNsPerPixel = 0;
+  bool wireBlocks = false;
+
+  bool busy() override { return wallTimeNs() < wireFreeNs; }
+  // When the last transmitted frame is (or will be) off the wire
+  int64_t wireFreeAtNs() const { return wireFreeNs; }
+  const OutputStats& currentStats() const { return stats; }
+
+  // Configure count chains of pixelsEach LEDs, all GRB unless orders are given
+  void beginChains(int count, int pixelsEach, const uint16_t* orders = nullptr) {
+    OutputConfig layout[MAX_OUTPUTS];
+    for (int p = 0; p < count; p++) {
+      layout[p].pixelPin = 12 + p;
+      layout[p].pixelCount = pixelsEach;
+      layout[p].colorOrder = orders ? orders[p] : NEO_GRB + NEO_KHZ800;
+    }
+    begin(layout, count);
+  }
+
+ protected:
+  void configurePort(int port, int pin, int pixelCount, uint16_t colorOrder) override {
+    chains[port].pin = pin;
+    chains[port].count = pixelCount;
+    chains[port].colorOrder = colorOrder;
+  }
+  void releasePort(int port) override { chains[port].count = 0; }
+  void clearBuffer() override {
+    for (int p = 0; p < portCount; p++) memset(chains[p].bytes, 0, chains[p].count * 3);
+  }
+  void transmit() override {
+    transmits++;
+    if (wireNsPerPixel) {
+      sleepUntilNs(wireFreeNs);
+      wireFreeNs = wallTimeNs() + (int64_t)totalPixels * wireNsPerPixel;
+      if (wireBlocks) sleepUntilNs(wireFreeNs);
+    }
+    if (!blockingNsPerPixel) return;
+    int64_t until = cpuTimeNs() + (int64_t)totalPixels * blockingNsPerPixel;
+    while (cpuTimeNs() < until) {
+    }
+  }
+  uint8_t* pixelBuffer(int port) override { return chains[port].bytes; }
+
+ private:
+  std::atomic<int64_t> wireFreeNs{0};
+};
+
+// WS2812 wire time: 24 bits of 1.25 us each
+constexpr uint32_t WS2812_NS_PER_PIXEL = 30000;
+
+#endif
@@ -0,0 +1,62 @@
+#ifndef HOST_ADAFRUIT_NEOPIXEL_H
+#define HOST_ADAFRUIT_NEOPIXEL_H
+
+// Adafruit_NeoPixel stand-in: color helpers, color order decoding and a pixel buffer that show() counts
+#include <Arduino.h>
+
+#define NEO_RGB ((0 << 6) | (0 << 4) | (1 << 2) | (2))
+#define NEO_RBG ((0 << 6) | (0 << 4) | (2 << 2) | (1))
+#define NEO_GRB ((1 << 6) | (1 << 4) | (0 << 2) | (2))
+#define NEO_GBR ((2 << 6) | (2 << 4) | (0 << 2) | (1))
+#define NEO_BRG ((1 << 6) | (1 << 4) | (2 << 2) | (0))
+#define NEO_BGR ((2 << 6) | (2 << 4) | (1 << 2) | (0))
+#define NEO_KHZ800 0x0000
+
+typedef uint16_t neoPixelType;
+
+extern uint32_t hostWireFrames;
+
+class Adafruit_NeoPixel {
+ public:
+  Adafruit_NeoPixel() {}
+  Adafruit_NeoPixel(uint16_t n, int16_t p, neoPixelType t) : pin(p), type(t) { updateLength(n); }
+  ~Adafruit_NeoPixel() { delete[] pixels; }
+
+  void begin() {}
+  void show() { hostWireFrames++; }
+  void clear() {
+    if (pixels) memset(pixels, 0, count * 3);
+  }
+  void updateType(neoPixelType t) { type = t; }
+  void updateLength(uint16_t n) {
+    delete[] pixels;
+    count = n;
+    pixels = new uint8_t[n * 3]();
+  }
+  uint16_t numPixels() const { return count; }
+  int16_t getPin() const { return pin; }
+  void setPin(int16_t p) { pin = p; }
+  uint8_t* getPixels() const { return pixels; }
+
+  static uint32_t Color(uint8_t r, uint8_t g, uint8_t b) { return ((uint32_t)r << 16) | ((uint32_t)g << 8) | b; }
+  static neoPixelType str2order(const char* v) {
+    int8_t r = 0, g = 0, b = 0;
+    if (v) {
+      for (int8_t i = 0; v[i] && i < 3; i++) {
+        char c = toupper(v[i]);
+        if (c == 'R') r = i;
+        else if (c == 'G') g = i;
+        else if (c == 'B') b = i;
+      }
+    }
+    return (r << 6) | (r << 4) | (g << 2) | b;
+  }
+
+ private:
+  uint16_t count = 0;
+  int16_t pin = -1;
+  neoPixelType type = NEO_GRB + NEO_KHZ800;
+  uint8_t* pixels = nullptr;
+};
+
+#endif
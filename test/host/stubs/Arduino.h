@@ -0,0 +1,112 @@
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+// Host stand-in for the ESP32 Arduino core: just enough of Arduino, FreeRTOS and the ESP class for
+// the firmware sources to build and run under the tests. Time only moves when a test advances it.
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+#include <ctype.h>
+#include <algorithm>
+#include <string>
+
+using std::min;
+using std::max;
+
+typedef uint8_t byte;
+
+#define PI 3.1415926535897932384626433832795
+#define TWO_PI 6.283185307179586476925286766559
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+#define F(x) x
+
+// newlib provides strlcpy on the ESP32; glibc only gained it in 2.38
+inline size_t hostStrlcpy(char* dst, const char* src, size_t size) {
+  size_t n = strlen(src);
+  if (size) {
+    size_t copy = n < size - 1 ? n : size - 1;
+    memcpy(dst, src, copy);
+    dst[copy] = 0;
+  }
+  return n;
+}
+#define strlcpy hostStrlcpy
+
+long map(long x, long inMin, long inMax, long outMin, long outMax);
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+uint32_t esp_random();
+
+// Fake clock shared by millis(), micros(), esp_timer_get_time() and the FreeRTOS tick
+extern int64_t hostNowUs;
+inline void hostAdvanceUs(int64_t us) { hostNowUs += us; }
+// Called from micros(), which the firmware reads while a mode renders: lets a test act like a task
+// that preempts the render loop mid-frame
+extern void (*hostMicrosHook)();
+
+// Serial output is dropped unless HOST_VERBOSE is set in the environment
+class HardwareSerial {
+ public:
+  void begin(unsigned long) {}
+  int printf(const char* format, ...) __attribute__((format(printf, 2, 3)));
+  void print(const char* s) { printf("%s", s); }
+  void print(long v) { printf("%ld", v); }
+  void println(const char* s) { printf("%s\n", s); }
+  void println(long v) { printf("%ld\n", v); }
+  void println(unsigned long v) { printf("%lu\n", v); }
+  void println(int v) { println((long)v); }
+  void println(unsigned v) { println((unsigned long)v); }
+  void println() { printf("\n"); }
+};
+extern HardwareSerial Serial;
+
+// Free heap is modelled from the test allocator's live bytes; there is no fragmentation model,
+// so the largest block is the free heap
+class EspClass {
+ public:
+  uint32_t getFreeHeap();
+  uint32_t getMaxAllocHeap() { return getFreeHeap(); }
+};
+extern EspClass ESP;
+
+class String {
+ public:
+  String(const char* s = "") : value(s ? s : "") {}
+  const char* c_str() const { return value.c_str(); }
+  unsigned length() const { return value.length(); }
+  void trim();
+  void toUpperCase();
+  bool startsWith(const char* prefix) const { return value.compare(0, strlen(prefix), prefix) == 0; }
+  void remove(unsigned index, unsigned count) { value.erase(index, count); }
+
+ private:
+  std::string value;
+};
+
+// FreeRTOS: a 1 ms tick on the fake clock. Tasks run on real threads, which only the pipeline
+// tests start; their notification waits time out in real milliseconds.
+typedef uint32_t TickType_t;
+typedef void* TaskHandle_t;
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+#define portMAX_DELAY 0xFFFFFFFF
+#define pdTRUE 1
+TickType_t xTaskGetTickCount();
+void vTaskDelay(TickType_t ticks);
+void vTaskDelayUntil(TickType_t* previousWake, TickType_t period);
+uint32_t ulTaskNotifyTake(int clearOnExit, TickType_t timeout);
+void xTaskNotifyGive(TaskHandle_t task);
+inline int xPortGetCoreID() { return 1; }
+int xTaskCreatePinnedToCore(void (*code)(void*), const char* name, int stackDepth, void* parameter, int priority,
+                            TaskHandle_t* handle, int core);
+
+// Single-threaded host: critical sections only record that they were entered
+typedef struct { int owner; int count; } portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED {0, 0}
+#define portENTER_CRITICAL(mux) ((mux)->count++)
+#define portEXIT_CRITICAL(mux) ((mux)->count--)
+
+#endif
@@ -0,0 +1,261 @@
+#ifndef HOST_ARDUINOJSON_H
+#define HOST_ARDUINOJSON_H
+
+// The part of the ArduinoJson 6 API the settings parser uses, over a small recursive-descent
+// parser. Like the real DynamicJsonDocument, a document allocates while parsing and frees
+// everything when it goes out of scope.
+#include <Arduino.h>
+#include <vector>
+
+struct JsonNode {
+  enum Type { NUL, BOOLEAN, INTEGER, REAL, STRING, ARRAY, OBJECT } type = NUL;
+  long long integer = 0;
+  double real = 0;
+  std::string text;
+  std::vector<std::string> keys;  // OBJECT member names, parallel to children
+  std::vector<JsonNode> children; // ARRAY items or OBJECT member values
+};
+
+class JsonVariantConst;
+
+class JsonArrayConst {
+ public:
+  class iterator {
+   public:
+    explicit iterator(const JsonNode* n) : node(n) {}
+    JsonVariantConst operator*() const;
+    iterator& operator++() {
+      node++;
+      return *this;
+    }
+    bool operator!=(const iterator& other) const { return node != other.node; }
+
+   private:
+    const JsonNode* node;
+  };
+
+  explicit JsonArrayConst(const JsonNode* n = nullptr) : node(n && n->type == JsonNode::ARRAY ? n : nullptr) {}
+  iterator begin() const { return iterator(node ? node->children.data() : nullptr); }
+  iterator end() const { return iterator(node ? node->children.data() + node->children.size() : nullptr); }
+  size_t size() const { return node ? node->children.size() : 0; }
+
+ private:
+  const JsonNode* node;
+};
+
+class JsonVariantConst {
+ public:
+  explicit JsonVariantConst(const JsonNode* n = nullptr) : node(n) {}
+
+  bool isNull() const { return !node || node->type == JsonNode::NUL; }
+  bool containsKey(const char* key) const { return member(key) != nullptr; }
+  JsonVariantConst operator[](const char* key) const { return JsonVariantConst(member(key)); }
+
+  template <typename T>
+  bool is() const;
+  template <typename T>
+  T as() const;
+  template <typename T>
+  operator T() const { return as<T>(); }
+
+  int operator|(int fallback) const;
+  const char* operator|(const char* fallback) const;
+
+ private:
+  const JsonNode* node;
+
+  const JsonNode* member(const char* key) const {
+    if (!node || node->type != JsonNode::OBJECT || !key) return nullptr;
+    for (size_t i = 0; i < node->keys.size(); i++) {
+      if (node->keys[i] == key) return &node->children[i];
+    }
+    return nullptr;
+  }
+  double number() const {
+    if (!node) return 0;
+    if (node->type == JsonNode::INTEGER || node->type == JsonNode::BOOLEAN) return (double)node->integer;
+    if (node->type == JsonNode::REAL) return node->real;
+    return 0;
+  }
+};
+
+inline JsonVariantConst JsonArrayConst::iterator::operator*() const { return JsonVariantConst(node); }
+
+template <> inline bool JsonVariantConst::is<const char*>() const { return node && node->type == JsonNode::STRING; }
+template <> inline bool JsonVariantConst::is<int>() const { return node && node->type == JsonNode::INTEGER; }
+template <> inline bool JsonVariantConst::is<uint32_t>() const {
+  return node && node->type == JsonNode::INTEGER && node->integer >= 0 && node->integer <= 0xFFFFFFFFLL;
+}
+template <> inline bool JsonVariantConst::is<bool>() const { return node && node->type == JsonNode::BOOLEAN; }
+template <> inline bool JsonVariantConst::is<float>() const {
+  return node && (node->type == JsonNode::INTEGER || node->type == JsonNode::REAL);
+}
+
+template <> inline const char* JsonVariantConst::as<const char*>() const { return is<const char*>() ? node->text.c_str() : nullptr; }
+template <> inline int JsonVariantConst::as<int>() const { return (int)number(); }
+template <> inline long JsonVariantConst::as<long>() const { return (long)number(); }
+template <> inline unsigned JsonVariantConst::as<unsigned>() const { return (unsigned)(long long)number(); }
+template <> inline uint8_t JsonVariantConst::as<uint8_t>() const { return (uint8_t)number(); }
+template <> inline uint16_t JsonVariantConst::as<uint16_t>() const { return (uint16_t)number(); }
+template <> inline float JsonVariantConst::as<float>() const { return (float)number(); }
+template <> inline double JsonVariantConst::as<double>() const { return number(); }
+template <> inline bool JsonVariantConst::as<bool>() const { return number() != 0; }
+template <> inline JsonArrayConst JsonVariantConst::as<JsonArrayConst>() const { return JsonArrayConst(node); }
+template <> inline JsonVariantConst JsonVariantConst::as<JsonVariantConst>() const { return *this; }
+
+inline int JsonVariantConst::operator|(int fallback) const { return is<int>() ? as<int>() : fallback; }
+inline const char* JsonVariantConst::operator|(const char* fallback) const {
+  return is<const char*>() ? as<const char*>() : fallback;
+}
+
+class DeserializationError {
+ public:
+  enum Code { Ok, EmptyInput, IncompleteInput, InvalidInput, NoMemory };
+  DeserializationError(Code c = Ok) : code(c) {}
+  explicit operator bool() const { return code != Ok; }
+  const char* c_str() const {
+    static const char* const names[] = {"Ok", "EmptyInput", "IncompleteInput", "InvalidInput", "NoMemory"};
+    return names[code];
+  }
+
+ private:
+  Code code;
+};
+
+class DynamicJsonDocument {
+ public:
+  explicit DynamicJsonDocument(size_t capacity) : capacity(capacity) {}
+
+  bool containsKey(const char* key) const { return as<JsonVariantConst>().containsKey(key); }
+  JsonVariantConst operator[](const char* key) const { return as<JsonVariantConst>()[key]; }
+  template <typename T>
+  T as() const { return JsonVariantConst(&root).as<T>(); }
+
+ private:
+  friend DeserializationError deserializeJson(DynamicJsonDocument& doc, const char* input);
+  size_t capacity;
+  JsonNode root;
+};
+
+namespace host_json {
+
+struct Parser {
+  const char* p;
+  int depth = 0;
+
+  void skipSpace() {
+    while (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r') p++;
+  }
+  bool literal(const char* word) {
+    size_t n = strlen(word);
+    if (strncmp(p, word, n) != 0) return false;
+    p += n;
+    return true;
+  }
+  bool string(std::string& out) {
+    if (*p != '"') return false;
+    p++;
+    while (*p && *p != '"') {
+      char c = *p++;
+      if (c == '\\') {
+        c = *p++;
+        if (c == 'n') c = '\n';
+        else if (c == 't') c = '\t';
+        else if (c == 'u') {
+          // Only the ASCII range is needed by the settings format
+          c = (char)strtol(std::string(p, 4).c_str(), nullptr, 16);
+          p += 4;
+        } else if (!c) return false;
+      }
+      out += c;
+    }
+    if (*p != '"') return false;
+    p++;
+    return true;
+  }
+  bool value(JsonNode& node) {
+    if (++depth > 10) return false;
+    skipSpace();
+    bool ok = true;
+    if (*p == '{') {
+      node.type = JsonNode::OBJECT;
+      p++;
+      skipSpace();
+      if (*p == '}') p++;
+      else {
+        for (;;) {
+          skipSpace();
+          std::string key;
+          if (!string(key)) return false;
+          skipSpace();
+          if (*p++ != ':') return false;
+          node.keys.push_back(key);
+          node.children.emplace_back();
+          if (!value(node.children.back())) return false;
+          skipSpace();
+          if (*p == ',') p++;
+          else if (*p == '}') {
+            p++;
+            break;
+          } else return false;
+        }
+      }
+    } else if (*p == '[') {
+      node.type = JsonNode::ARRAY;
+      p++;
+      skipSpace();
+      if (*p == ']') p++;
+      else {
+        for (;;) {
+          node.children.emplace_back();
+          if (!value(node.children.back())) return false;
+          skipSpace();
+          if (*p == ',') p++;
+          else if (*p == ']') {
+            p++;
+            break;
+          } else return false;
+        }
+      }
+    } else if (*p == '"') {
+      node.type = JsonNode::STRING;
+      ok = string(node.text);
+    } else if (literal("true")) {
+      node.type = JsonNode::BOOLEAN;
+      node.integer = 1;
+    } else if (literal("false")) {
+      node.type = JsonNode::BOOLEAN;
+    } else if (literal("null")) {
+      node.type = JsonNode::NUL;
+    } else {
+      char* end = nullptr;
+      double real = strtod(p, &end);
+      if (end == p) return false;
+      bool integral = true;
+      for (const char* c = p; c < end; c++) {
+        if (*c == '.' || *c == 'e' || *c == 'E') integral = false;
+      }
+      node.type = integral ? JsonNode::INTEGER : JsonNode::REAL;
+      node.integer = integral ? strtoll(p, nullptr, 10) : (long long)real;
+      node.real = real;
+      p = end;
+    }
+    depth--;
+    return ok;
+  }
+};
+
+}  // namespace host_json
+
+inline DeserializationError deserializeJson(DynamicJsonDocument& doc, const char* input) {
+  doc.root = JsonNode();
+  if (!input || !*input) return DeserializationError::EmptyInput;
+  host_json::Parser parser{input};
+  if (!parser.value(doc.root)) {
+    doc.root = JsonNode();
+    return *parser.p ? DeserializationError::InvalidInput : DeserializationError::IncompleteInput;
+  }
+  return DeserializationError::Ok;
+}
+
+#endif
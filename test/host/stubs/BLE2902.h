@@ -0,0 +1,12 @@
+#ifndef HOST_BLE2902_H
+#define HOST_BLE2902_H
+
+#include <BLEDevice.h>
+
+class BLE2902 : public BLEDescriptor {
+ public:
+  bool getNotifications() { return false; }
+  void setNotifications(bool) {}
+};
+
+#endif
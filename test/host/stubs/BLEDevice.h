@@ -0,0 +1,75 @@
+#ifndef HOST_BLEDEVICE_H
+#define HOST_BLEDEVICE_H
+
+// No radio on the host: the BLE classes exist so communications.cpp builds, and do nothing
+#include <Arduino.h>
+
+class BLEUUID {
+ public:
+  BLEUUID(uint16_t) {}
+  BLEUUID(const char*) {}
+};
+
+class BLEDescriptor {
+ public:
+  virtual ~BLEDescriptor() {}
+};
+
+class BLECharacteristic;
+class BLECharacteristicCallbacks {
+ public:
+  virtual ~BLECharacteristicCallbacks() {}
+  virtual void onWrite(BLECharacteristic*) {}
+  virtual void onRead(BLECharacteristic*) {}
+};
+
+class BLECharacteristic {
+ public:
+  static const uint32_t PROPERTY_READ = 1 << 0;
+  static const uint32_t PROPERTY_WRITE = 1 << 1;
+  static const uint32_t PROPERTY_NOTIFY = 1 << 2;
+  void setValue(const char* s) { value = s; }
+  std::string getValue() { return value; }
+  void notify() {}
+  void addDescriptor(BLEDescriptor*) {}
+  BLEDescriptor* getDescriptorByUUID(BLEUUID) { return nullptr; }
+  void setCallbacks(BLECharacteristicCallbacks*) {}
+
+ private:
+  std::string value;
+};
+
+class BLEService {
+ public:
+  BLECharacteristic* createCharacteristic(const char*, uint32_t) { return nullptr; }
+  void start() {}
+};
+
+class BLEAdvertising {
+ public:
+  void start() {}
+};
+
+class BLEServer;
+class BLEServerCallbacks {
+ public:
+  virtual ~BLEServerCallbacks() {}
+  virtual void onConnect(BLEServer*) {}
+  virtual void onDisconnect(BLEServer*) {}
+};
+
+class BLEServer {
+ public:
+  void setCallbacks(BLEServerCallbacks*) {}
+  BLEService* createService(const char*) { return nullptr; }
+  BLEAdvertising* getAdvertising() { return nullptr; }
+  void startAdvertising() {}
+};
+
+class BLEDevice {
+ public:
+  static void init(const char*) {}
+  static BLEServer* createServer() { return nullptr; }
+};
+
+#endif
@@ -0,0 +1,77 @@
+#ifndef HOST_NEOPIXELBUS_H
+#define HOST_NEOPIXELBUS_H
+
+// NeoPixelBus stand-in with the library's dirty-flag behaviour: Show() only sends when the edit
+// buffer was marked dirty, as the RMT method does. Each send is copied to the wire buffer and counted.
+#include <Arduino.h>
+
+struct NeoRgbFeature {};
+struct NeoEsp32RmtNWs2812xMethod {};
+enum NeoBusChannel { NeoBusChannel_0, NeoBusChannel_1, NeoBusChannel_2, NeoBusChannel_3 };
+
+struct RgbColor {
+  RgbColor(uint8_t r, uint8_t g, uint8_t b) : R(r), G(g), B(b) {}
+  uint8_t R, G, B;
+};
+
+// Frames actually clocked out, across all buses
+extern uint32_t hostWireFrames;
+
+// Every live bus, so tests can compare what was encoded with what went out
+struct HostBus {
+  const uint8_t* pixels;
+  const uint8_t* wire;
+  int count;
+};
+constexpr int HOST_MAX_BUSES = 8;
+extern HostBus hostBuses[HOST_MAX_BUSES];
+
+template <typename T_COLOR_FEATURE, typename T_METHOD>
+class NeoPixelBus {
+ public:
+  NeoPixelBus(uint16_t countPixels, uint8_t pin, NeoBusChannel channel)
+      : count(countPixels), pixels(new uint8_t[countPixels * 3]()), wire(new uint8_t[countPixels * 3]()) {
+    for (HostBus& bus : hostBuses) {
+      if (bus.count == 0) {
+        bus = {pixels, wire, count};
+        break;
+      }
+    }
+  }
+  ~NeoPixelBus() {
+    for (HostBus& bus : hostBuses) {
+      if (bus.pixels == pixels) bus = {nullptr, nullptr, 0};
+    }
+    delete[] pixels;
+    delete[] wire;
+  }
+
+  void Begin() { dirty = true; }
+  bool CanShow() const { return true; }
+  void ClearTo(RgbColor color) {
+    for (int i = 0; i < count; i++) {
+      pixels[i * 3] = color.R;
+      pixels[i * 3 + 1] = color.G;
+      pixels[i * 3 + 2] = color.B;
+    }
+    dirty = true;
+  }
+  void Show() {
+    if (!dirty) return;
+    memcpy(wire, pixels, count * 3);
+    dirty = false;
+    hostWireFrames++;
+  }
+  uint8_t* Pixels() { return pixels; }
+  void Dirty() { dirty = true; }
+  bool IsDirty() const { return dirty; }
+  uint16_t PixelCount() const { return count; }
+
+ private:
+  uint16_t count;
+  uint8_t* pixels;
+  uint8_t* wire;
+  bool dirty = false;
+};
+
+#endif
@@ -0,0 +1,21 @@
+#ifndef HOST_ESP_NOW_H
+#define HOST_ESP_NOW_H
+
+#include <Arduino.h>
+
+typedef int esp_err_t;
+#define ESP_OK 0
+
+typedef enum { ESP_NOW_SEND_SUCCESS, ESP_NOW_SEND_FAIL } esp_now_send_status_t;
+
+typedef struct {
+  uint8_t peer_addr[6];
+  uint8_t channel;
+  bool encrypt;
+} esp_now_peer_info_t;
+
+inline bool esp_now_is_peer_exist(const uint8_t*) { return true; }
+inline esp_err_t esp_now_add_peer(const esp_now_peer_info_t*) { return ESP_OK; }
+inline esp_err_t esp_now_send(const uint8_t*, const uint8_t*, size_t) { return ESP_OK; }
+
+#endif
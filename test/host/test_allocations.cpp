@@ -0,0 +1,144 @@
+#include "host_test.h"
+#include "lighting.h"
+#include "communications.h"
+
+// Every mode, switched to through the parser and rendered through handleStrip, the compositor and
+// the output stage, including the transition out of the previous mode. Only the parser may
+// allocate; the frames themselves must not touch the heap.
+TEST(modesRenderWithoutAllocating) {
+  bootFirmware();
+  char json[96];
+  for (int mode = 0; mode < modeCount; mode++) {
+    snprintf(json, sizeof(json), "{\"lightMode\":\"%s\",\"seed\":7}", modeTable[mode].name);
+    sendSettings(json);
+    CHECK(myData.modeId == mode);
+
+    uint32_t sent = hostWireFrames;
+    uint32_t allocations = hostHeap.allocations;
+    uint32_t frees = hostHeap.frees;
+    const int frames = 120;
+    for (int i = 0; i < frames; i++) runFrame(modeTable[mode].frameMs * 1000);
+    uint32_t perMode = hostHeap.allocations - allocations + hostHeap.frees - frees;
+    if (perMode) report("%s: %u new/delete over %d frames", modeTable[mode].name, perMode, frames);
+    CHECK(perMode == 0);
+    CHECK(hostWireFrames > sent);
+  }
+}
+
+// A burst of 1000 settings updates, as a slider drag or an app reconnecting sends them: speed,
+// colors and brightness every time, with mode, layer and segment changes mixed in. Free heap and
+// the largest block must read the same after every update as before the storm.
+TEST(updateStormKeepsHeapFlat) {
+  bootFirmware();
+  sendSettings("{\"lightMode\":\"aurora\",\"layers\":[],\"segments\":[]}");
+  runFrame(20000);
+  uint32_t freeHeap = ESP.getFreeHeap();
+  uint32_t largestBlock = ESP.getMaxAllocHeap();
+  uint32_t lowestFree = freeHeap;
+  uint32_t lowestBlock = largestBlock;
+
+  static const char* const modes[] = {"aurora", "juggle", "static", "breath", "tetrix", "candle"};
+  char json[320];
+  for (int i = 0; i < 1000; i++) {
+    int n = snprintf(json, sizeof(json), "{\"speed\":%d,\"intensity\":%d,\"brightness\":%d,\"colorOne\":\"#%06X\"",
+                     i % 101, 100 - i % 101, 20 + i % 80, (i * 2654435761u) & 0xFFFFFF);
+    if (i % 50 == 0) n += snprintf(json + n, sizeof(json) - n, ",\"lightMode\":\"%s\"", modes[i / 50 % 6]);
+    if (i % 200 == 100) n += snprintf(json + n, sizeof(json) - n, ",\"layers\":[{\"mode\":\"twinkles\",\"blend\":\"max\"}]");
+    if (i % 200 == 150) {
+      n += snprintf(json + n, sizeof(json) - n,
+                    ",\"layers\":[],\"segments\":[{\"length\":100,\"lightMode\":\"meteor\"},{\"length\":200,\"lightMode\":\"heartbeat\"}]");
+    }
+    if (i % 200 == 199) n += snprintf(json + n, sizeof(json) - n, ",\"segments\":[]");
+    snprintf(json + n, sizeof(json) - n, "}");
+    sendSettings(json);
+    CHECK(myData.speed == i % 101 && myData.colorOne == ((i * 2654435761u) & 0xFFFFFF));
+    if (i % 200 == 150) CHECK(myData.segmentCount == 2 && myData.layerCount == 0);
+    // Several updates can land within one frame
+    if (i % 3 == 0) runFrame(20000);
+
+    lowestFree = min(lowestFree, ESP.getFreeHeap());
+    lowestBlock = min(lowestBlock, ESP.getMaxAllocHeap());
+  }
+  for (int i = 0; i < 100; i++) runFrame(20000);
+
+  report("free heap %u -> %u (lowest %u), largest block %u -> %u (lowest %u)", freeHeap, ESP.getFreeHeap(), lowestFree,
+         largestBlock, ESP.getMaxAllocHeap(), lowestBlock);
+  CHECK(ESP.getFreeHeap() == freeHeap);
+  CHECK(ESP.getMaxAllocHeap() == largestBlock);
+  CHECK(lowestFree == freeHeap);
+  CHECK(lowestBlock == largestBlock);
+}
+
+// Mode state and scratch come from the fixed instance arena, so cycling through every mode, at the
+// largest strip and back, leaves exactly the heap the firmware booted with
+TEST(visitingAllModesRetainsNoHeap) {
+  bootFirmware();
+  sendSettings("{\"lightMode\":\"static\",\"layers\":[],\"segments\":[],\"ledCount\":300}");
+  for (int i = 0; i < 60; i++) runFrame(20000);
+  size_t baseline = hostHeap.liveBytes;
+
+  char json[96];
+  for (int pass = 0; pass < 2; pass++) {
+    // The second pass runs every mode through its resize hook as well
+    snprintf(json, sizeof(json), "{\"ledCount\":%d}", pass ? MAX_LED_COUNT : 300);
+    sendSettings(json);
+    for (int mode = 0; mode < modeCount; mode++) {
+      snprintf(json, sizeof(json), "{\"lightMode\":\"%s\"}", modeTable[mode].name);
+      sendSettings(json);
+      for (int i = 0; i < 30; i++) runFrame(20000);
+    }
+  }
+  sendSettings("{\"lightMode\":\"static\",\"ledCount\":300}");
+  // Let the last transition finish so the outgoing scene is released
+  for (int i = 0; i < 60; i++) runFrame(20000);
+  report("retained heap %zu -> %zu bytes", baseline, hostHeap.liveBytes);
+  CHECK(hostHeap.liveBytes == baseline);
+
+  // Offline renders acquire and release an instance each; the arena must not leak slots
+  // The frame pool is fully spoken for once the firmware runs
+  static uint32_t pixels[300];
+  StripData frame(pixels, 300);
+  for (int round = 0; round < 4; round++) {
+    for (int mode = 0; mode < modeCount; mode++) {
+      CHECK(renderModeOffline(mode, &frame, myData, 1 + mode, 0, 20000, 5, nullptr, nullptr));
+    }
+  }
+  CHECK(hostHeap.liveBytes == baseline);
+}
+
+// Per-pixel scratch comes from one shared arena, claimed by size: a full-strip claim per scene
+// fits, a third does not, and a released claim is reused
+TEST(scratchArenaIsClaimedBySize) {
+  bootFirmware();
+  // Neither the running nor the outgoing scene may hold scratch, which they keep until the next scene
+  sendSettings("{\"lightMode\":\"colorloop\",\"layers\":[],\"segments\":[],\"ledCount\":300}");
+  for (int i = 0; i < 60; i++) runFrame(20000);
+  sendSettings("{\"lightMode\":\"static\"}");
+  for (int i = 0; i < 60; i++) runFrame(20000);
+
+  int candle = findModeId("candle");
+  ModeInstance* current = acquireModeInstance(candle, 1);
+  ModeInstance* outgoing = acquireModeInstance(candle, 2);
+  ModeInstance* third = acquireModeInstance(findModeId("tetrix"), 3);
+  CHECK(current && outgoing && third);
+  if (!current || !outgoing || !third) return;
+
+  uint32_t* a = current->scratch<uint32_t>(MAX_LED_COUNT);
+  uint32_t* b = outgoing->scratch<uint32_t>(MAX_LED_COUNT);
+  CHECK(a && b && (b >= a + MAX_LED_COUNT || a >= b + MAX_LED_COUNT));
+  CHECK(third->scratch<bool>(10) == nullptr);
+  // Asking for no more than the claim keeps it in place
+  CHECK(current->scratch<uint32_t>(100) == a);
+
+  releaseModeInstance(current);
+  bool* c = third->scratch<bool>(MAX_LED_COUNT);
+  CHECK(c == (bool*)a);
+  // A short segment's claim leaves room beside it
+  ModeInstance* segment = acquireModeInstance(candle, 4);
+  CHECK(segment && segment->scratch<uint32_t>(100) != nullptr);
+  report("scratch arena %d bytes for %d instance slots", MODE_SCRATCH_ARENA_SIZE, MAX_MODE_INSTANCES);
+
+  releaseModeInstance(segment);
+  releaseModeInstance(outgoing);
+  releaseModeInstance(third);
+}
@@ -0,0 +1,26 @@
+#include "host_test.h"
+#include "compositor.h"
+#include <NeoPixelBus.h>
+
+// A heartbeat layer pulses the strip; between beats the base mode beneath it stays lit
+TEST(heartbeatLayerKeepsBaseLit) {
+  bootFirmware();
+  sendSettings("{\"lightMode\":\"static\",\"colorOne\":\"#FF0000\",\"ledCount\":300,\"segments\":[],"
+               "\"layers\":[{\"mode\":\"heartbeat\",\"blend\":\"add\"}]}");
+  // Let the transition into the new scene finish
+  for (int i = 0; i < 60; i++) runFrame(20000);
+
+  int lowest = 255, highest = 0, darkestWire = 255;
+  for (int i = 0; i < 150; i++) {
+    runFrame(20000);
+    int envelope = sceneEnvelope(false);
+    lowest = min(lowest, envelope);
+    highest = max(highest, envelope);
+    darkestWire = min(darkestWire, (int)hostBuses[0].wire[1]); // Red of the first pixel on a GRB chain
+  }
+  report("heartbeat layer over static: envelope %d..%d, red on the wire down to %d", lowest, highest, darkestWire);
+  CHECK(lowest > 0);
+  CHECK(darkestWire > 0);
+  CHECK(highest > lowest);
+  sendSettings("{\"lightMode\":\"static\",\"layers\":[]}");
+}
@@ -0,0 +1,66 @@
+#include "host_test.h"
+#include "communications.h"
+#include <stdarg.h>
+#include <time.h>
+
+void setup();
+void handleStrip();
+
+static TestCase* tests = nullptr;
+static TestCase** lastTest = &tests;
+static int failures = 0;
+
+TestCase::TestCase(const char* name, TestFunction run) : name(name), run(run), next(nullptr) {
+  *lastTest = this;
+  lastTest = &next;
+}
+
+void testFailed(const char* file, int line, const char* what) {
+  printf("  %s:%d: CHECK(%s) failed\n", file, line, what);
+  failures++;
+}
+
+void report(const char* format, ...) {
+  va_list args;
+  va_start(args, format);
+  printf("  ");
+  vprintf(format, args);
+  printf("\n");
+  va_end(args);
+}
+
+int64_t cpuTimeNs() {
+  timespec now;
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &now);
+  return (int64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+void bootFirmware() {
+  static bool booted = false;
+  if (booted) return;
+  booted = true;
+  setup();
+}
+
+void sendSettings(const char* json) {
+  parseAndUpdateData(std::string(json), myData);
+}
+
+void runFrame(uint32_t periodUs) {
+  hostAdvanceUs(periodUs);
+  handleStrip();
+}
+
+int main(int argc, char** argv) {
+  int run = 0;
+  for (TestCase* test = tests; test; test = test->next) {
+    if (argc > 1 && !strstr(test->name, argv[1])) continue;
+    int before = failures;
+    printf("%s\n", test->name);
+    test->run();
+    printf("%s %s\n", failures == before ? "ok  " : "FAIL", test->name);
+    run++;
+  }
+  printf("%d tests, %d failed checks\n", run, failures);
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,418 @@
+#include "mock_output.h"
+#include "lighting.h"
+
+static MockOutput mock;
+static uint32_t framePixels[MAX_LED_COUNT];
+
+static void fillPattern(StripData& frame, uint32_t seed) {
+  for (int i = 0; i < frame.pixelCount; i++) {
+    frame.pixels[i] = ((i + seed) * 2654435761u) & 0xFFFFFF;
+  }
+  frame.markAllDirty();
+}
+
+// Wire byte of channel (16 = red, 8 = green, 0 = blue) of pixel i on a GRB chain
+static uint8_t wireChannel(const MockOutput::Chain& chain, int i, int shift) {
+  static const int grbOffset[] = {2, 0, 1}; // blue, green, red
+  return chain.bytes[i * 3 + grbOffset[shift / 8]];
+}
+
+// The output stage writes color-ordered, brightness-scaled bytes straight into the chain buffer
+TEST(encodeWritesScaledWireBytes) {
+  mock.beginChains(1, 300);
+  mock.setKeepAlive(0);
+  StripData frame(framePixels, 300);
+  for (int brightness : {255, 128, 51}) {
+    mock.setBrightness(brightness);
+    fillPattern(frame, brightness);
+    mock.encode(&frame);
+    int wrong = 0;
+    for (int i = 0; i < 300; i++) {
+      for (int shift = 0; shift < 24; shift += 8) {
+        uint8_t value = (frame.pixels[i] >> shift) & 0xFF;
+        if (wireChannel(mock.chains[0], i, shift) != lround(value * brightness / 255.0)) wrong++;
+      }
+    }
+    if (wrong) report("brightness %d: %d wrong channels", brightness, wrong);
+    CHECK(wrong == 0);
+  }
+}
+
+// Adafruit_NeoPixel::setPixelColor with setBrightness: one call per pixel that swizzles and
+// scales, as show() used to copy the frame
+__attribute__((noinline)) static void setPixelColorReference(uint8_t* pixels, int n, uint32_t c, uint8_t brightness) {
+  uint8_t r = c >> 16, g = c >> 8, b = c;
+  if (brightness) {
+    r = (r * brightness) >> 8;
+    g = (g * brightness) >> 8;
+    b = (b * brightness) >> 8;
+  }
+  uint8_t* p = pixels + n * 3;
+  p[1] = r;
+  p[0] = g;
+  p[2] = b;
+}
+
+TEST(benchmarkOutputCost) {
+  mock.beginChains(1, MAX_LED_COUNT);
+  mock.setBrightness(51);
+  mock.setDither(false);
+  StripData frame(framePixels, MAX_LED_COUNT);
+  fillPattern(frame, 1);
+  mock.encode(&frame);
+
+  static uint8_t copy[MAX_LED_COUNT * 3];
+  int64_t perPixelCopy = benchmarkNs(2000, [&](int n) {
+    for (int i = 0; i < MAX_LED_COUNT; i++) setPixelColorReference(copy, i, frame.pixels[i] + n, 52);
+  });
+  int64_t full = benchmarkNs(2000, [&](int n) {
+    frame.pixels[n % MAX_LED_COUNT] ^= 0x010101;
+    frame.markAllDirty();
+    mock.encode(&frame);
+  });
+  int64_t partial = benchmarkNs(20000, [&](int n) {
+    int at = n * 97 % (MAX_LED_COUNT - 10);
+    for (int i = at; i < at + 10; i++) frame.setPixelColor(i, frame.pixels[i] ^ 0x010101);
+    mock.encode(&frame);
+  });
+  int64_t unchanged = benchmarkNs(20000, [&](int) { mock.encode(&frame); });
+
+  report("%d LEDs: per-pixel setPixelColor copy %lld ns | encode (LUT, fingerprint, power sum) full %lld ns, 10 dirty pixels %lld ns, unchanged %lld ns",
+         MAX_LED_COUNT, (long long)perPixelCopy, (long long)full, (long long)partial, (long long)unchanged);
+  CHECK(partial < full);
+  CHECK(unchanged < partial);
+}
+
+// The dispatch callModeFunction replaced: the frame's lightMode copied into a String and compared
+// against every mode name in turn
+static const char* const cascadeOrder[] = {
+    "static", "statictri", "percent", "percenttri", "shift", "washingmachine", "blink", "blinktoggle",
+    "blinkrandom", "heartbeat", "twinkles", "swipe", "swiperandom", "colorloop", "breath", "sweep",
+    "sweepdual", "theater", "fireworks", "juggle", "bouncingballs", "meteor", "tetrix", "perlinmove",
+    "stream", "palette", "plasma", "pacifica", "sunrise", "aurora", "candle"};
+
+__attribute__((noinline)) static int cascadeDispatch(const char* lightMode) {
+  String effect(lightMode);
+  for (int i = 0; i < (int)(sizeof(cascadeOrder) / sizeof(cascadeOrder[0])); i++) {
+    if (strcmp(effect.c_str(), cascadeOrder[i]) == 0) return i;
+  }
+  return MODE_UNKNOWN;
+}
+
+TEST(benchmarkModeDispatch) {
+  bootFirmware();
+  struct_message cfg;
+  cloneData(myData, cfg);
+  StripData frame(framePixels, 1);
+  int64_t nowUs = 0;
+  report("%-8s %12s %14s %14s", "mode", "cascade ns", "findModeId ns", "table call ns");
+  for (const char* name : {"static", "candle"}) {
+    int modeId = findModeId(name);
+    CHECK(cascadeDispatch(name) == modeId);
+    ModeInstance* instance = acquireModeInstance(modeId, 1);
+    // One pixel, so the call is mostly dispatch: the old path looked the mode up and then called it
+    int64_t cascade = benchmarkNs(200000, [&](int) {
+      callModeFunction(cascadeDispatch(name), &frame, &cfg, instance, nowUs += 20000);
+    });
+    int64_t lookup = benchmarkNs(200000, [&](int) { framePixels[0] += findModeId(name); });
+    int64_t table = benchmarkNs(200000, [&](int) {
+      callModeFunction(modeId, &frame, &cfg, instance, nowUs += 20000);
+    });
+    releaseModeInstance(instance);
+    report("%-8s %12lld %14lld %14lld", name, (long long)cascade, (long long)lookup, (long long)table);
+    // findModeId now runs once per settings update; frames only pay for the table call
+    CHECK(table < cascade);
+  }
+}
+
+// One channel at a time, the way the kernel is specified: w2 = weight + weight/128 out of 256
+static uint32_t blendReference(uint32_t a, uint32_t b, uint8_t weight) {
+  uint32_t w2 = weight + (weight >> 7);
+  uint32_t out = 0;
+  for (int shift = 0; shift < 24; shift += 8) {
+    uint32_t x = (a >> shift) & 0xFF;
+    uint32_t y = (b >> shift) & 0xFF;
+    out |= ((x * (256 - w2) + y * w2) >> 8) << shift;
+  }
+  return out;
+}
+
+// Linear-light mix in floating point
+static uint32_t blendLinearReference(uint32_t a, uint32_t b, uint8_t weight) {
+  uint32_t out = 0;
+  for (int shift = 0; shift < 24; shift += 8) {
+    float x = powf(((a >> shift) & 0xFF) / 255.0f, 2.2f);
+    float y = powf(((b >> shift) & 0xFF) / 255.0f, 2.2f);
+    float mixed = x + (y - x) * weight / 255.0f;
+    out |= (uint32_t)lroundf(powf(mixed, 1 / 2.2f) * 255.0f) << shift;
+  }
+  return out;
+}
+
+TEST(blendMatchesReference) {
+  initBlendTables();
+  uint32_t state = 1;
+  int mismatches = 0;
+  int linearWorst = 0;
+  int linearDarkWorst = 0;
+  for (int pair = 0; pair < 20000; pair++) {
+    state = state * 1664525u + 1013904223u;
+    uint32_t a = state >> 8;
+    state = state * 1664525u + 1013904223u;
+    uint32_t b = state >> 8;
+    for (int weight = 0; weight < 256; weight++) {
+      if (blendPixels(a, b, weight) != blendReference(a, b, weight)) mismatches++;
+    }
+    if (pair % 20 == 0) {
+      for (int weight = 0; weight < 256; weight += 5) {
+        uint32_t got = blendPixelsLinear(a, b, weight);
+        uint32_t want = blendLinearReference(a, b, weight);
+        for (int shift = 0; shift < 24; shift += 8) {
+          int expected = (want >> shift) & 0xFF;
+          int error = abs((int)((got >> shift) & 0xFF) - expected);
+          if (expected < 16) linearDarkWorst = max(linearDarkWorst, error);
+          else linearWorst = max(linearWorst, error);
+        }
+      }
+    }
+  }
+  // The ends land exactly on either color
+  CHECK(blendPixels(0x123456, 0xABCDEF, 0) == 0x123456);
+  CHECK(blendPixels(0x123456, 0xABCDEF, 255) == 0xABCDEF);
+  report("SWAR blend: %d mismatches over 20000 pairs x 256 weights; linear blend within %d of float (%d below 16)",
+         mismatches, linearWorst, linearDarkWorst);
+  CHECK(mismatches == 0);
+  // Linear mixing goes through a 12-bit table; its steps are coarse next to
+  // the gamma curve near black, so only the darkest outputs drift further
+  CHECK(linearWorst <= 1);
+  CHECK(linearDarkWorst <= 8);
+}
+
+TEST(benchmarkTransitionBlend) {
+  initBlendTables();
+  mock.beginChains(1, MAX_LED_COUNT);
+  mock.setBrightness(255);
+  static uint32_t oldPixels[MAX_LED_COUNT];
+  StripData from(oldPixels, MAX_LED_COUNT);
+  StripData to(framePixels, MAX_LED_COUNT);
+  fillPattern(from, 3);
+  fillPattern(to, 4);
+
+  static uint32_t out[MAX_LED_COUNT];
+  volatile uint32_t sink = 0;
+  int64_t reference = benchmarkNs(2000, [&](int n) {
+    for (int i = 0; i < MAX_LED_COUNT; i++) out[i] = blendReference(from.pixels[i], to.pixels[i], n);
+    sink = sink + out[n % MAX_LED_COUNT];
+  });
+  int64_t swar = benchmarkNs(2000, [&](int n) {
+    for (int i = 0; i < MAX_LED_COUNT; i++) out[i] = blendPixels(from.pixels[i], to.pixels[i], n);
+    sink = sink + out[n % MAX_LED_COUNT];
+  });
+  int64_t linear = benchmarkNs(2000, [&](int n) {
+    for (int i = 0; i < MAX_LED_COUNT; i++) out[i] = blendPixelsLinear(from.pixels[i], to.pixels[i], n);
+    sink = sink + out[n % MAX_LED_COUNT];
+  });
+  int64_t encoded = benchmarkNs(2000, [&](int n) { mock.encodeBlend(&from, &to, n, false); });
+
+  report("%d LEDs per frame: per-channel blend %lld ns, SWAR blend %lld ns, linear blend %lld ns, encodeBlend %lld ns",
+         MAX_LED_COUNT, (long long)reference, (long long)swar, (long long)linear, (long long)encoded);
+  CHECK(swar > 0 && encoded > 0);
+}
+
+// Dithered wire bytes average out to the level the 8-bit wire can't express: every source value
+// at brightness 51, held for 256 frames
+TEST(ditherAveragesToExactLevel) {
+  mock.beginChains(1, 256);
+  mock.setKeepAlive(0);
+  mock.setBrightness(51);
+  StripData frame(framePixels, 256);
+  for (int i = 0; i < 256; i++) frame.pixels[i] = i * 0x010101;
+  static uint32_t sums[256];
+  double worst[2] = {0, 0};
+  for (int dithered = 0; dithered < 2; dithered++) {
+    mock.setDither(dithered);
+    memset(sums, 0, sizeof(sums));
+    for (int n = 0; n < 256; n++) {
+      frame.markAllDirty();
+      mock.encode(&frame);
+      for (int i = 0; i < 256; i++) sums[i] += wireChannel(mock.chains[0], i, 8);
+    }
+    for (int i = 0; i < 256; i++) {
+      double error = fabs(sums[i] / 256.0 - i * 51 / 255.0);
+      worst[dithered] = max(worst[dithered], error);
+    }
+  }
+  mock.setDither(false);
+  report("mean wire level vs exact over 256 frames: %.4f without dither, %.4f with", worst[0], worst[1]);
+  // The table itself is 8.8 fixed point, so the mean can only be off by its rounding
+  CHECK(worst[1] <= 1 / 256.0 + 1e-9);
+  CHECK(worst[0] > 0.25);
+}
+
+// Dithering forces a full re-encode every frame; price that against the usual partial update
+TEST(benchmarkDitherCost) {
+  mock.beginChains(1, MAX_LED_COUNT);
+  mock.setKeepAlive(0);
+  mock.setBrightness(51);
+  StripData frame(framePixels, MAX_LED_COUNT);
+  fillPattern(frame, 5);
+  int64_t cost[2];
+  for (int dithered = 0; dithered < 2; dithered++) {
+    mock.setDither(dithered);
+    mock.encode(&frame);
+    cost[dithered] = benchmarkNs(5000, [&](int n) {
+      int at = n * 97 % (MAX_LED_COUNT - 10);
+      for (int i = at; i < at + 10; i++) frame.setPixelColor(i, frame.pixels[i] ^ 0x010101);
+      mock.encode(&frame);
+    });
+  }
+  mock.setDither(false);
+  report("%d LEDs, 10 dirty pixels per frame: encode %lld ns without dither, %lld ns with",
+         MAX_LED_COUNT, (long long)cost[0], (long long)cost[1]);
+  CHECK(cost[0] < cost[1]);
+}
+
+// The RMT backend hands the frame to the peripheral and returns; the bit-banged one holds the CPU
+// for the whole wire time. Drive 30 frames of 300 LEDs through each and time the loop's CPU.
+TEST(asyncShowReturnsCpu) {
+  mock.beginChains(1, 300);
+  mock.setKeepAlive(0);
+  mock.setBrightness(255);
+  StripData frame(framePixels, 300);
+  int64_t spent[2];
+  for (int blocking = 0; blocking < 2; blocking++) {
+    mock.blockingNsPerPixel = blocking ? WS2812_NS_PER_PIXEL : 0;
+    uint32_t before = mock.transmits;
+    int64_t start = cpuTimeNs();
+    for (int n = 0; n < 30; n++) {
+      fillPattern(frame, n);
+      if (mock.encode(&frame)) mock.show();
+    }
+    spent[blocking] = cpuTimeNs() - start;
+    CHECK(mock.transmits - before == 30);
+  }
+  mock.blockingNsPerPixel = 0;
+  report("30 frames of 300 LEDs: %lld us of CPU with a blocking show, %lld us async (%lld us back to the loop)",
+         (long long)spent[1] / 1000, (long long)spent[0] / 1000, (long long)(spent[1] - spent[0]) / 1000);
+  // 9 ms of wire time per frame against a few microseconds of encoding
+  CHECK(spent[0] * 20 < spent[1]);
+}
+
+// A 1000-LED frame split over four pins, each chain with its own color order
+TEST(splitFrameMapsEachChain) {
+  static const uint16_t orders[] = {NEO_RGB, NEO_GRB, NEO_BRG, NEO_BGR};
+  // Wire position of red, green and blue for each order above
+  static const int positions[][3] = {{0, 1, 2}, {1, 0, 2}, {1, 2, 0}, {2, 1, 0}};
+  mock.beginChains(4, 250, orders);
+  mock.setKeepAlive(0);
+  mock.setBrightness(255);
+  mock.setDither(false);
+  CHECK(mock.numPixels() == 1000);
+  StripData frame(framePixels, 1000);
+  fillPattern(frame, 7);
+  mock.encode(&frame);
+  mock.collectStats();
+
+  int wrong = 0;
+  for (int i = 0; i < 1000; i++) {
+    const MockOutput::Chain& chain = mock.chains[i / 250];
+    const uint8_t* wire = chain.bytes + (i % 250) * 3;
+    const int* at = positions[i / 250];
+    uint32_t c = frame.pixels[i];
+    if (wire[at[0]] != ((c >> 16) & 0xFF) || wire[at[1]] != ((c >> 8) & 0xFF) || wire[at[2]] != (c & 0xFF)) wrong++;
+  }
+  if (wrong) report("%d pixels landed on the wrong chain or in the wrong order", wrong);
+  CHECK(wrong == 0);
+
+  // A dirty span inside the third chain re-encodes only that span
+  static MockOutput::Chain before[4];
+  memcpy(before, mock.chains, sizeof(before));
+  for (int i = 560; i < 570; i++) frame.setPixelColor(i, frame.pixels[i] ^ 0xFFFFFF);
+  mock.encode(&frame);
+  CHECK(mock.collectStats().bytesEncoded == 10 * 3);
+  for (int p = 0; p < 4; p++) {
+    int changed = 0;
+    for (int b = 0; b < 250 * 3; b++) {
+      bool inSpan = p == 2 && b >= 60 * 3 && b < 70 * 3;
+      if ((mock.chains[p].bytes[b] != before[p].bytes[b]) != inSpan) changed++;
+    }
+    if (changed) report("chain %d: %d bytes outside the dirty span changed or inside it didn't", p, changed);
+    CHECK(changed == 0);
+  }
+
+  report("wire time per frame: %u us with 1000 LEDs on one pin, %u us split over 4 pins of 250",
+         1000 * WS2812_NS_PER_PIXEL / 1000, 250 * WS2812_NS_PER_PIXEL / 1000);
+}
+
+// Encode white frames until the limiter settles; returns the wire byte every channel ended up at
+static int settleWhite(StripData& frame, int frames) {
+  for (int n = 0; n < frames; n++) {
+    frame.markAllDirty();
+    mock.encode(&frame);
+  }
+  return mock.chains[0].bytes[0];
+}
+
+// A full-white strip against a small supply: the limiter scales the wire bytes down to the budget,
+// holds steady through small headroom changes and lets go once the budget is lifted
+TEST(powerLimiterScalesWhite) {
+  mock.beginChains(1, 300);
+  mock.setKeepAlive(0);
+  mock.setBrightness(255);
+  mock.setDither(false);
+  mock.setPowerLimit(5000, 20, 1);
+  StripData frame(framePixels, 300);
+  for (int i = 0; i < 300; i++) frame.pixels[i] = 0xFFFFFF;
+
+  // Unlimited the strip would draw 300 * 3 * 20 mA plus 300 mA idle
+  const int unlimited = 300 * 3 * 20;
+  int level = settleWhite(frame, 4);
+  uint8_t limit = mock.powerLimit();
+  int uneven = 0;
+  for (int b = 0; b < 300 * 3; b++) uneven += mock.chains[0].bytes[b] != level;
+  report("5000 mA budget for %d mA of white: limiter %u/255, wire level %d, estimate %u mA",
+         unlimited + 300, limit, level, mock.estimatedMilliamps());
+  CHECK(uneven == 0);
+  CHECK(abs(level - limit) <= 1);
+  CHECK(mock.estimatedMilliamps() <= 5000);
+  CHECK(mock.estimatedMilliamps() > 5000 * 95 / 100);
+  CHECK(mock.currentStats().framesLimited > 0);
+
+  // A couple of steps of headroom is inside the hysteresis: the table isn't rebuilt
+  mock.setPowerLimit(300 + (limit + 2) * unlimited / 255, 20, 1);
+  settleWhite(frame, 4);
+  CHECK(mock.powerLimit() == limit);
+  // More than that and it recovers
+  mock.setPowerLimit(300 + (limit + 10) * unlimited / 255, 20, 1);
+  settleWhite(frame, 4);
+  CHECK(mock.powerLimit() > limit + 4);
+  // Tightening backs off at once
+  mock.setPowerLimit(3000, 20, 1);
+  settleWhite(frame, 1);
+  CHECK(mock.powerLimit() < limit);
+  // No budget, no limiting
+  mock.setPowerLimit(0, 20, 1);
+  CHECK(settleWhite(frame, 2) == 255);
+  CHECK(mock.powerLimit() == 255);
+}
+
+// Switching dither back on starts from a clean residue, so the first frame is the same every time
+TEST(ditherRestartsClean) {
+  mock.beginChains(1, 256);
+  mock.setKeepAlive(0);
+  mock.setBrightness(51);
+  StripData frame(framePixels, 256);
+  for (int i = 0; i < 256; i++) frame.pixels[i] = i * 0x010101;
+  static uint8_t first[2][256 * 3];
+  for (int run = 0; run < 2; run++) {
+    mock.setDither(false);
+    mock.setDither(true);
+    for (int n = 0; n < 3 + run * 4; n++) {
+      frame.markAllDirty();
+      mock.encode(&frame);
+      if (n == 0) memcpy(first[run], mock.chains[0].bytes, sizeof(first[run]));
+    }
+  }
+  mock.setDither(false);
+  CHECK(memcmp(first[0], first[1], sizeof(first[0])) == 0);
+}
@@ -0,0 +1,113 @@
+#include "mock_output.h"
+#include "pipeline.h"
+
+// Built into pipeline_tests only, where the firmware is compiled with DUAL_CORE_PIPELINE=1
+#if DUAL_CORE_PIPELINE
+
+static MockOutput mock;
+static uint32_t renderPixels[MAX_LED_COUNT];
+static const int64_t RUN_NS = 350000000;
+// COST_HEAVY's per-pixel estimate for the ESP32; the host renders an order of magnitude faster
+static const int64_t ESP32_HEAVY_NS_PER_PIXEL = 4000;
+
+struct FrameRates {
+  double shown;
+  double rendered;
+};
+
+// One frame of the loop core's render work. With renderNs set it is held to that long, by sleeping
+// so that on a single host CPU the output task can run meanwhile as it would on its own core.
+static void render(int modeId, StripData& frame, struct_message& cfg, ModeInstance* instance, int64_t renderNs) {
+  int64_t start = wallTimeNs();
+  callModeFunction(modeId, &frame, &cfg, instance, start / 1000);
+  if (renderNs) sleepUntilNs(start + renderNs);
+}
+
+// Frames that reached the strip per second, timed until the last one is off the wire
+static FrameRates rates(uint32_t shownBefore, int rendered, int64_t start, int64_t drainNs) {
+  sleepUntilNs(wallTimeNs() + drainNs);
+  double seconds = (mock.wireFreeAtNs() - start) / 1e9;
+  return {(mock.transmits - shownBefore) / seconds, rendered / seconds};
+}
+
+// Everything on the loop core: render, encode, then the driver's show()
+static FrameRates runSingleCore(int modeId, struct_message& cfg, ModeInstance* instance, int64_t renderNs) {
+  mock.beginChains(1, cfg.pixelCount);
+  StripData frame(renderPixels, cfg.pixelCount);
+  uint32_t before = mock.transmits;
+  int rendered = 0;
+  int64_t start = wallTimeNs();
+  while (wallTimeNs() - start < RUN_NS) {
+    render(modeId, frame, cfg, instance, renderNs);
+    if (mock.encode(&frame)) mock.show();
+    rendered++;
+  }
+  return rates(before, rendered, start, (int64_t)cfg.pixelCount * WS2812_NS_PER_PIXEL);
+}
+
+// The loop core renders and publishes, as show() does in a pipeline build; the output task
+// encodes and pushes whatever was published last
+static FrameRates runPipeline(int modeId, struct_message& cfg, ModeInstance* instance, int64_t renderNs) {
+  StripData frame(renderPixels, cfg.pixelCount);
+  uint32_t before = mock.transmits;
+  int rendered = 0;
+  int64_t start = wallTimeNs();
+  while (wallTimeNs() - start < RUN_NS) {
+    render(modeId, frame, cfg, instance, renderNs);
+    StripData* out = pipelineBackFrame();
+    out->resize(frame.pixelCount);
+    memcpy(out->pixels, frame.pixels, frame.pixelCount * sizeof(uint32_t));
+    out->markAllDirty();
+    pipelinePublish(cfg, 255);
+    rendered++;
+  }
+  // The output task still sends the last published frame; let it finish before the loop core
+  // touches the driver again
+  return rates(before, rendered, start, (int64_t)2 * cfg.pixelCount * WS2812_NS_PER_PIXEL);
+}
+
+// Frames per second reaching a 300 and a 1000 LED strip, with everything on one core and with the
+// output task on the other, for a blocking driver and for an asynchronous one. Rendered at host
+// speed, and held to the ESP32's estimate for a heavy mode.
+TEST(pipelineFrameRates) {
+  initBlendTables();
+  initFramePool();
+  initModeInstances();
+  output = &mock;
+  initPipeline();
+
+  struct_message cfg;
+  cloneData(myData, cfg);
+  cfg.keepAlive = 0;
+  int modeId = findModeId("aurora");
+  ModeInstance* instance = acquireModeInstance(modeId, 1);
+  CHECK(instance != nullptr);
+  if (!instance) return;
+  mock.wireNsPerPixel = WS2812_NS_PER_PIXEL;
+
+  for (int pixels : {300, 1000}) {
+    cfg.pixelCount = cfg.ledCount = pixels;
+    StripData frame(renderPixels, pixels);
+    int64_t hostNs = benchmarkNs(50, [&](int n) { callModeFunction(modeId, &frame, &cfg, instance, n * 20000); });
+    for (int64_t renderNs : {(int64_t)0, ESP32_HEAVY_NS_PER_PIXEL * pixels}) {
+      for (bool blocking : {true, false}) {
+        mock.wireBlocks = blocking;
+        FrameRates single = runSingleCore(modeId, cfg, instance, renderNs);
+        FrameRates pipeline = runPipeline(modeId, cfg, instance, renderNs);
+        report("%4d LEDs, %-8s driver, render %4lld us: single core %5.1f fps | pipeline %5.1f fps shown, %6.0f rendered",
+               pixels, blocking ? "blocking" : "async", (long long)(renderNs ? renderNs : hostNs) / 1000, single.shown,
+               pipeline.shown, pipeline.rendered);
+        // Never slower than one core, and the renderer is no longer held to the wire
+        CHECK(pipeline.shown >= single.shown * 0.9);
+        CHECK(pipeline.rendered > pipeline.shown);
+        // A blocking driver stalls the single-core loop for the whole wire time, so the pipeline
+        // gains the render time back
+        if (blocking && renderNs) CHECK(pipeline.shown > single.shown * 1.05);
+      }
+    }
+  }
+  mock.wireNsPerPixel = 0;
+  releaseModeInstance(instance);
+}
+
+#endif
@@ -0,0 +1,103 @@
+#include "host_test.h"
+#include "lighting.h"
+#include "communications.h"
+#include <NeoPixelBus.h>
+
+extern StripData* stripData;
+extern int transitionValue;
+extern struct_message myLiveData;
+
+// A speed slider drag recorded from the app: one write per input event, ms from the first
+struct SliderEvent {
+  uint16_t atMs;
+  uint8_t value;
+};
+static const SliderEvent speedDrag[] = {
+  {0, 10},   {14, 11},  {31, 13},  {47, 16},  {62, 19},  {80, 23},  {96, 27},  {113, 31}, {129, 35},
+  {146, 39}, {164, 43}, {180, 46}, {197, 50}, {213, 53}, {231, 57}, {247, 60}, {263, 63}, {280, 66},
+  {297, 68}, {313, 71}, {330, 73}, {348, 76}, {363, 78}, {380, 80}, {414, 83}, {447, 85}, {497, 87},
+  {563, 88}, {647, 89}, {780, 90},
+};
+static const int DRAG_EVENTS = sizeof(speedDrag) / sizeof(speedDrag[0]);
+
+// Everything the output stage encoded went out on the wire
+static bool encodedFrameSent() {
+  for (const HostBus& bus : hostBuses) {
+    if (bus.count && memcmp(bus.pixels, bus.wire, bus.count * 3) != 0) return false;
+  }
+  return true;
+}
+
+// Replay the drag against a running mode at 50 fps. The drag moves speed, and colorOne from red
+// to blue alongside it unless the mode only takes colorOne up on a restart. The running mode must
+// glide along: the scene never restarts and every encoded frame reaches the strip.
+static void replayDrag(int modeId) {
+  char json[128];
+  snprintf(json, sizeof(json), "{\"lightMode\":\"%s\",\"speed\":10,\"colorOne\":16711680,\"slewMs\":250}", modeTable[modeId].name);
+  sendSettings(json);
+  // Let the transition into the mode finish
+  for (int i = 0; i < 60; i++) runFrame(20000);
+  CHECK(transitionValue == 0);
+
+  bool dragColor = !(modeTable[modeId].restarts & PARAM_COLOR_ONE);
+  const StripData* frame = stripData;
+  int restarts = 0;
+  int unsent = 0;
+  int64_t startUs = hostNowUs;
+  int next = 0;
+  for (int f = 0; f < 60; f++) {
+    hostAdvanceUs(20000);
+    // Deliver the writes that arrived since the last frame
+    while (next < DRAG_EVENTS && startUs + speedDrag[next].atMs * 1000 <= hostNowUs) {
+      int value = speedDrag[next].value;
+      if (dragColor) {
+        uint32_t color = blendPixels(0xFF0000, 0x0000FF, (value - 10) * 255 / 80);
+        snprintf(json, sizeof(json), "{\"speed\":%d,\"colorOne\":%u}", value, color);
+      } else {
+        snprintf(json, sizeof(json), "{\"speed\":%d}", value);
+      }
+      sendSettings(json);
+      next++;
+    }
+    runFrame(0);
+    if (stripData != frame || transitionValue != 0) restarts++;
+    frame = stripData;
+    if (!encodedFrameSent()) unsent++;
+  }
+
+  if (restarts || unsent) report("%s: %d restarts, %d frames not sent", modeTable[modeId].name, restarts, unsent);
+  CHECK(restarts == 0);
+  CHECK(unsent == 0);
+  // The glide has landed on the last value
+  CHECK(myLiveData.speed == 90);
+  CHECK(!dragColor || myLiveData.colorOne == 0x0000FF);
+}
+
+TEST(sliderDragGlidesWithoutRestarts) {
+  bootFirmware();
+  sendSettings("{\"layers\":[],\"segments\":[],\"ledCount\":300}");
+  for (int mode = 0; mode < modeCount; mode++) replayDrag(mode);
+}
+
+// An update that lands while a frame renders (the BLE task preempting the loop) must be kept for
+// the next frame, not cleared with the one being rendered
+static void sendModeChange() {
+  hostMicrosHook = nullptr;
+  sendSettings("{\"lightMode\":\"aurora\"}");
+}
+
+TEST(updateDuringFrameIsKept) {
+  bootFirmware();
+  sendSettings("{\"lightMode\":\"juggle\",\"layers\":[],\"segments\":[]}");
+  for (int i = 0; i < 60; i++) runFrame(20000);
+  CHECK(transitionValue == 0);
+
+  hostMicrosHook = sendModeChange;
+  runFrame(20000);
+  CHECK(hostMicrosHook == nullptr);
+  CHECK(myData.updated);
+  runFrame(20000);
+  CHECK(!myData.updated);
+  CHECK(transitionValue > 0);
+  CHECK(myLiveData.modeId == findModeId("aurora"));
+}
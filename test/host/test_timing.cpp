@@ -0,0 +1,87 @@
+#include "host_test.h"
+#include "lighting.h"
+
+// Modes advance on elapsed time, so three seconds of animation must end on the same frame whether
+// it was rendered at 20, 60 or 200 fps. Positions, random draws and fades all have to agree.
+static const int TIMING_PIXELS = 300;
+static const int64_t TIMING_SPAN_US = 3000000;
+
+static void renderSpan(int modeId, const struct_message& cfg, uint32_t frameUs, uint32_t* pixels) {
+  StripData frame(pixels, TIMING_PIXELS);
+  int frames = (TIMING_SPAN_US + frameUs - 1) / frameUs;
+  CHECK(renderModeOffline(modeId, &frame, cfg, 1234, 0, frameUs, frames + 1, nullptr, nullptr));
+}
+
+// Largest per-channel difference between two frames
+static int maxDifference(const uint32_t* a, const uint32_t* b) {
+  int largest = 0;
+  for (int i = 0; i < TIMING_PIXELS; i++) {
+    for (int shift = 0; shift < 24; shift += 8) {
+      largest = max(largest, abs((int)((a[i] >> shift) & 0xFF) - (int)((b[i] >> shift) & 0xFF)));
+    }
+  }
+  return largest;
+}
+
+TEST(modesMatchAcrossFrameRates) {
+  bootFirmware();
+  struct_message cfg;
+  cloneData(myData, cfg);
+  cfg.speed = 70;
+  cfg.intensity = 60;
+  cfg.count = 3;
+  cfg.colorOne = 0xFF2000;
+  cfg.colorTwo = 0x00FF40;
+  cfg.colorThree = 0x2020FF;
+  cfg.layerCount = 0;
+  cfg.segmentCount = 0;
+
+  static uint32_t at20[TIMING_PIXELS], at60[TIMING_PIXELS], at200[TIMING_PIXELS];
+  for (int mode = 0; mode < modeCount; mode++) {
+    renderSpan(mode, cfg, 50000, at20);
+    renderSpan(mode, cfg, 16667, at60);
+    renderSpan(mode, cfg, 5000, at200);
+    int diff60 = maxDifference(at20, at60);
+    int diff200 = maxDifference(at20, at200);
+    if (diff60 || diff200) report("%s: 20 vs 60 fps differ by %d, 20 vs 200 fps by %d", modeTable[mode].name, diff60, diff200);
+    // Float time accumulation may round a channel the other way
+    CHECK(diff60 <= 1 && diff200 <= 1);
+  }
+}
+
+// Make the render being measured take renderUs: callModeFunction reads micros() first to start the
+// clock, and the next read (inside the mode or at the end) lands renderUs later
+static int64_t renderUs;
+static int microsReads;
+static void slowRender() {
+  if (++microsReads < 2) return;
+  hostMicrosHook = nullptr;
+  hostAdvanceUs(renderUs);
+}
+
+static void renderTimed(int modeId, const struct_message& cfg, int pixelCount, int64_t us) {
+  static uint32_t pixels[MAX_LED_COUNT];
+  StripData frame(pixels, pixelCount);
+  renderUs = us;
+  microsReads = 0;
+  hostMicrosHook = slowRender;
+  CHECK(renderModeOffline(modeId, &frame, cfg, 1, hostNowUs, 20000, 1, nullptr, nullptr));
+  CHECK(hostMicrosHook == nullptr);
+}
+
+// The measured cost is per pixel and seeded by the first render, so a heavy mode reads its real
+// cost right away and a short segment doesn't skew what a full strip is expected to take
+TEST(modeCostIsPerPixelFromFirstRender) {
+  bootFirmware();
+  struct_message cfg;
+  cloneData(myData, cfg);
+  int modeId = findModeId("plasma");
+  renderTimed(modeId, cfg, 300, 3000);
+  CHECK(modeCostUs(modeId, 300) == 3000);
+  CHECK(modeCostUs(modeId, 30) == 300);
+  // A 30-pixel segment at the same per-pixel speed leaves the full-strip figure alone
+  for (int i = 0; i < 8; i++) renderTimed(modeId, cfg, 30, 300);
+  CHECK(modeCostUs(modeId, 300) == 3000);
+  report("plasma: %u us for 300 pixels after one render, %u us for a 30-pixel segment",
+         modeCostUs(modeId, 300), modeCostUs(modeId, 30));
+}